@@ -0,0 +1,365 @@
+#pragma once
+
+#include "bench.hpp"
+#include "universe.hpp"
+#include "starship.hpp"
+#include "tiles.hpp"
+#include "sfx.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <sstream>
+
+namespace He {
+	Scenario::Scenario() {}
+
+	Scenario::Scenario(string path) {
+		ifstream in(path);
+
+		if (!in) {
+			cerr << "Unable to open scenario " << path << endl;
+			valid = false;
+			return;
+		}
+
+		string key;
+
+		while (in >> key) {
+			if (key[0] == '#') {
+				getline(in, key);
+			} else if (key == "ships") {
+				in >> ships;
+			} else if (key == "bodies") {
+				in >> bodies;
+			} else if (key == "idle") {
+				in >> idle;
+			} else if (key == "orbits") {
+				in >> orbits;
+			} else if (key == "particles") {
+				in >> particles;
+			} else if (key == "ticks") {
+				in >> ticks;
+			} else if (key == "threads") {
+				string line;
+				getline(in, line);
+
+				stringstream counts(line);
+				threads.clear();
+
+				for (uint32_t n; counts >> n;) {
+					threads.push_back(n);
+				}
+
+				if (threads.empty()) {
+					cerr << "Scenario key threads needs at least one count" << endl;
+					valid = false;
+				}
+			} else if (key == "seed") {
+				in >> seed;
+			} else if (key == "theta") {
+				in >> theta;
+			} else if (key == "delta") {
+				in >> delta;
+			} else if (key == "integrator") {
+				in >> integrator;
+			} else if (key == "energy") {
+				in >> energy;
+			} else if (key == "sleeping") {
+				in >> sleeping;
+			} else if (key == "velocity") {
+				in >> velocity;
+			} else if (key == "focus") {
+				in >> focus;
+			} else if (key == "exhaust") {
+				in >> exhaust;
+			} else if (key == "reference") {
+				in >> reference;
+			} else {
+				cerr << "Unknown scenario key " << key << endl;
+				getline(in, key);
+				valid = false;
+			}
+		}
+
+		if (!in.eof()) {
+			cerr << "Bad value for scenario key " << key << endl;
+			valid = false;
+		}
+	}
+
+	static uint32_t strayExhaust(Universe& universe, const vector<Starship*>& ships) {
+		ParticlePool& p = universe.particles;
+		uint32_t strays = 0;
+
+		for (uint32_t i = 0; i < p.count(); i++) {
+			if (p.maxLife[i] == 0 || p.maxLife[i] - p.life[i] > universe.delta * 1.5f) {
+				continue;
+			}
+
+			bool near = false;
+
+			for (Starship* ship : ships) {
+				vec2 d = vec2(p.x[i], p.y[i]) - universe.relative(ship->phys);
+				float reach = (float)(ship->width + ship->height) + 2 * length(vec2(ship->phys.vx(), ship->phys.vy())) * universe.delta;
+
+				if (dot(d, d) <= reach * reach) {
+					near = true;
+					break;
+				}
+			}
+
+			strays += !near;
+		}
+
+		return strays;
+	}
+
+	static double gravityError(Universe& universe) {
+		PhysicsWorld& world = universe.objects;
+		uint32_t n = world.size();
+
+		universe.gravity.build(&world, universe.originX, universe.originY);
+		universe.gravity.apply(0, n);
+
+		vector<float> ax(world.ax.begin(), world.ax.begin() + n), ay(world.ay.begin(), world.ay.begin() + n);
+
+		universe.gravity.direct(0, n);
+
+		double worst = 0;
+
+		for (uint32_t i = 0; i < n; i++) {
+			double dx = ax[i] - world.ax[i], dy = ay[i] - world.ay[i];
+			double ref = sqrt((double)world.ax[i] * world.ax[i] + (double)world.ay[i] * world.ay[i]);
+
+			if (ref != 0) {
+				double e = sqrt(dx * dx + dy * dy) / ref;
+				worst = e > worst ? e : worst;
+			}
+		}
+
+		return worst;
+	}
+
+	static int run(Scenario& scenario, uint32_t& threads, TickTimings& timings, double& total) {
+		Universe universe;
+		universe.jobs.setThreads(threads);
+		threads = universe.jobs.threads();
+		universe.gravity.theta = scenario.theta;
+		universe.delta = scenario.delta;
+		universe.sleeping = scenario.sleeping;
+
+		if (scenario.integrator == "euler") {
+			universe.integrator = Integrator::Euler;
+		} else if (scenario.integrator == "semi") {
+			universe.integrator = Integrator::SemiImplicit;
+		} else if (scenario.integrator == "leapfrog") {
+			universe.integrator = Integrator::Leapfrog;
+		} else if (scenario.integrator == "adaptive") {
+			universe.integrator = Integrator::Adaptive;
+		} else {
+			cerr << "Unknown integrator " << scenario.integrator << endl;
+			return -1;
+		}
+
+		PlatingTile plating(&universe);
+		EngineTile engine(&universe);
+		TurretTile turret(&universe);
+
+		mt19937 gen(scenario.seed);
+		uniform_real_distribution<float> pos(-5000, 5000), vel(-5, 5), mass(1e6, 1e12), unit(0, 1);
+
+		universe.random = Random(scenario.seed);
+
+		vector<Starship*> ships;
+		uint32_t side = (uint32_t)ceil(sqrt((float)scenario.ships));
+
+		for (uint32_t i = 0; i < scenario.ships; i++) {
+			Starship* ship = new Starship(5, 8);
+
+			for (int x = 0; x < 5; x++) {
+				ship->set(x, 0, &engine);
+
+				for (int y = 1; y < 7; y++) {
+					ship->set(x, y, &plating);
+				}
+			}
+
+			ship->set(2, 7, &turret);
+
+			ship->phys = universe.objects.add((float)(i % side) * 10 - side * 5, (float)(i / side) * 10 - side * 5, scenario.velocity, 0, (float)ship->mass);
+			ship->rot = unit(gen) * 360;
+			ship->throttle = 1;
+			ship->thrust = true;
+			ship->turn = (float)(i % 3) - 1;
+
+			ships.push_back(ship);
+			universe.ships.push_back(ship);
+		}
+
+		if (scenario.focus && !ships.empty()) {
+			universe.focus = ships[0]->phys;
+		}
+
+		for (uint32_t i = 0; i < scenario.bodies; i++) {
+			universe.objects.add(pos(gen), pos(gen), vel(gen), vel(gen), mass(gen));
+		}
+
+		for (uint32_t i = 0; i < scenario.idle; i++) {
+			universe.objects.add(pos(gen), pos(gen), 1000);
+		}
+
+		if (scenario.orbits != 0) {
+			const float earth = 5.97219e24;
+			uniform_real_distribution<float> radius(1e6, 1e7), angle(0, radians(360.0f));
+
+			universe.objects.add(0, 0, 0, 0, earth);
+
+			for (uint32_t i = 0; i < scenario.orbits; i++) {
+				float r = radius(gen), a = angle(gen), v = sqrt(PhysicsWorld::G * earth / r);
+
+				universe.objects.add(cos(a) * r, sin(a) * r, -sin(a) * v, cos(a) * v, 1000);
+			}
+		}
+
+		for (uint32_t i = 0; i < scenario.particles; i++) {
+			universe.emit(Particle(
+				vec2(pos(gen), pos(gen)),
+				vec2(vel(gen), vel(gen)),
+				vec4(1, 1, 1, 1),
+				10,
+				0,
+				Behaviour::Drift,
+				gen()
+			));
+		}
+
+		universe.timings = TickTimings();
+
+		double energy = scenario.energy ? universe.objects.energy() : 0;
+
+		uint32_t rebases = 0, strays = 0;
+
+		auto start = chrono::steady_clock::now();
+
+		for (uint32_t t = 0; t < scenario.ticks; t++) {
+			int32_t ox = universe.originX, oy = universe.originY;
+
+			universe.tick();
+
+			if (scenario.exhaust) {
+				rebases += universe.originX != ox || universe.originY != oy;
+				strays += strayExhaust(universe, ships);
+			}
+		}
+
+		total = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		timings = universe.timings;
+
+		uint32_t live = universe.particles.count();
+
+		TickTimings& t = universe.timings;
+		double ticks = scenario.ticks == 0 ? 1 : scenario.ticks;
+
+		cout << "ships " << scenario.ships << ", bodies " << scenario.bodies << " (" << universe.objects.awake << " awake at end), particles " << scenario.particles << " (" << live << " live at end)" << endl;
+		cout << "ticks " << scenario.ticks << " of " << scenario.delta << "s, threads " << universe.jobs.threads() << ", theta " << scenario.theta << ", integrator " << scenario.integrator << endl;
+
+		if (scenario.energy) {
+			double end = universe.objects.energy();
+
+			cout << "energy drift " << abs(end - energy) / abs(energy) << endl;
+		}
+
+		if (scenario.exhaust) {
+			cout << "origin moved " << rebases << " times, " << strays << " exhaust particles spawned away from their ship" << endl;
+		}
+
+		double error = scenario.reference != 0 ? gravityError(universe) : 0;
+
+		if (scenario.reference != 0) {
+			cout << "gravity error against direct summation " << error << " (tolerance " << scenario.reference << ")" << endl;
+		}
+
+		ios format(nullptr);
+		format.copyfmt(cout);
+
+		cout << fixed << setprecision(3);
+		cout << left << setw(12) << "subsystem" << right << setw(12) << "total ms" << setw(12) << "ms/tick" << endl;
+
+		auto row = [ticks](const char* name, double ms) {
+			cout << left << setw(12) << name << right << setw(12) << ms << setw(12) << ms / ticks << endl;
+		};
+
+		row("ships", t.ships);
+		row("gravity", t.gravity);
+		row("integrate", t.integrate);
+		row("sleep", t.sleep);
+		row("broadphase", t.broadphase);
+		row("particles", t.particles);
+		row("total", total);
+
+		cout.copyfmt(format);
+
+		for (Starship* ship : ships) {
+			delete ship;
+		}
+
+		if (scenario.exhaust && (rebases == 0 || strays != 0)) {
+			return 1;
+		}
+
+		return error > scenario.reference ? 1 : 0;
+	}
+
+	int runBenchmark(Scenario scenario) {
+		if (!scenario.valid) {
+			return -1;
+		}
+
+		uint32_t runs = scenario.threads.size();
+		vector<TickTimings> timings(runs);
+		vector<double> totals(runs);
+
+		if (runs > 1) {
+			uint32_t threads = scenario.threads[0];
+			streambuf* out = cout.rdbuf(nullptr);
+
+			run(scenario, threads, timings[0], totals[0]);
+
+			cout.rdbuf(out);
+			cout.clear();
+		}
+
+		for (uint32_t i = 0; i < runs; i++) {
+			int result = run(scenario, scenario.threads[i], timings[i], totals[i]);
+
+			if (result != 0) {
+				return result;
+			}
+		}
+
+		if (runs > 1) {
+			double ticks = scenario.ticks == 0 ? 1 : scenario.ticks;
+			ios format(nullptr);
+			format.copyfmt(cout);
+
+			cout << fixed << setprecision(3);
+			cout << left << setw(12) << "threads" << right << setw(12) << "particles" << setw(12) << "speedup" << setw(12) << "total" << setw(12) << "speedup" << endl;
+
+			for (uint32_t i = 0; i < runs; i++) {
+				cout << left << setw(12) << scenario.threads[i] << right << setw(12) << timings[i].particles / ticks << setw(12) << timings[0].particles / timings[i].particles << setw(12) << totals[i] / ticks << setw(12) << totals[0] / totals[i] << endl;
+			}
+
+			cout.copyfmt(format);
+		}
+
+		return 0;
+	}
+}
+
+#ifdef HELIUM_BENCH
+int main(int argc, char** argv) {
+	return He::runBenchmark(argc > 1 ? He::Scenario(argv[1]) : He::Scenario());
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "main.hpp"
+#include "argon.hpp"
+
+using namespace Ar;
+
+namespace He {
+	struct Scenario {
+	public:
+		uint32_t ships = 100, bodies = 10000, idle = 0, orbits = 0, particles = 100000, ticks = 600, seed = 1;
+		float theta = 0.5, delta = 1.0 / 60, velocity = 0, reference = 0;
+		string integrator = "leapfrog";
+		vector<uint32_t> threads = { 0 };
+		bool energy = false, sleeping = true, focus = false, exhaust = false, valid = true;
+
+		Scenario();
+
+		Scenario(string path);
+	};
+
+	int runBenchmark(Scenario scenario);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "broadphase.hpp"
+
+#include <algorithm>
+
+namespace He {
+	bool Bounds::overlaps(const Bounds& other) const {
+		return minX <= other.maxX && maxX >= other.minX && minY <= other.maxY && maxY >= other.minY;
+	}
+
+	SpatialHash::SpatialHash(float cellSize) : cellSize(cellSize) {}
+
+	void SpatialHash::clear() {
+		bounds.clear();
+		cells.clear();
+		pairs.clear();
+	}
+
+	int32_t SpatialHash::cell(float v) {
+		return (int32_t)floor(v / cellSize);
+	}
+
+	void SpatialHash::insert(uint32_t id, Bounds box) {
+		if (bounds.size() <= id) {
+			bounds.resize(id + 1, Bounds{ 0, 0, -1, -1 });
+		}
+
+		bounds[id] = box;
+
+		int32_t x0 = cell(box.minX), y0 = cell(box.minY), x1 = cell(box.maxX), y1 = cell(box.maxY);
+
+		for (int32_t x = x0; x <= x1; x++) {
+			for (int32_t y = y0; y <= y1; y++) {
+				cells.push_back(CellEntry{ ((uint64_t)(uint32_t)x << 32) | (uint32_t)y, id });
+			}
+		}
+	}
+
+	void SpatialHash::build() {
+		pairs.clear();
+
+		sort(cells.begin(), cells.end(), [](const CellEntry& a, const CellEntry& b) {
+			return a.cell < b.cell || (a.cell == b.cell && a.id < b.id);
+			});
+
+		for (size_t start = 0, end; start < cells.size(); start = end) {
+			uint64_t key = cells[start].cell;
+			int32_t cx = (int32_t)(uint32_t)(key >> 32), cy = (int32_t)(uint32_t)key;
+
+			for (end = start + 1; end < cells.size() && cells[end].cell == key; end++);
+
+			for (size_t i = start; i < end; i++) {
+				const Bounds& a = bounds[cells[i].id];
+
+				for (size_t j = i + 1; j < end; j++) {
+					const Bounds& b = bounds[cells[j].id];
+
+					if (!a.overlaps(b)) {
+						continue;
+					}
+
+					float ox = a.minX > b.minX ? a.minX : b.minX;
+					float oy = a.minY > b.minY ? a.minY : b.minY;
+
+					if (cell(ox) == cx && cell(oy) == cy) {
+						pairs.push_back(make_pair(cells[i].id, cells[j].id));
+					}
+				}
+			}
+		}
+	}
+}
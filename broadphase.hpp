@@ -0,0 +1,40 @@
+#pragma once
+
+#include "main.hpp"
+#include "argon.hpp"
+
+using namespace Ar;
+
+namespace He {
+	struct Bounds {
+	public:
+		float minX, minY, maxX, maxY;
+
+		bool overlaps(const Bounds& other) const;
+	};
+
+	struct CellEntry {
+	public:
+		uint64_t cell;
+		uint32_t id;
+	};
+
+	class SpatialHash {
+	public:
+		float cellSize;
+		vector<Bounds> bounds;
+		vector<CellEntry> cells;
+		vector<pair<uint32_t, uint32_t>> pairs;
+
+		SpatialHash(float cellSize = 32);
+
+		void clear();
+
+		void insert(uint32_t id, Bounds box);
+
+		void build();
+
+	private:
+		int32_t cell(float v);
+	};
+}
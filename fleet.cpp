@@ -0,0 +1,316 @@
+#pragma once
+
+#include "fleet.hpp"
+#include "universe.hpp"
+#include "starship.hpp"
+#include "shaders.hpp"
+#include "stream.hpp"
+
+namespace He {
+	FleetRenderer::FleetRenderer() {
+		glGenVertexArrays(1, &vao);
+		glGenBuffers(1, &ebo);
+
+		grow(1 << 16);
+		index(1 << 10);
+	}
+
+	void FleetRenderer::render(Universe* universe) {
+		vector<Starship*>& ships = universe->ships;
+		uint32_t n = ships.size();
+		bool moved = false;
+
+		reclaim();
+
+		if (n == 0) {
+			return;
+		}
+
+		for (Starship* ship : ships) {
+			moved |= reserve(ship);
+		}
+
+		if (moved) {
+			for (Starship* ship : ships) {
+				ship->stale = true;
+			}
+		}
+
+		uint32_t columns = 0;
+
+		for (Starship* ship : ships) {
+			columns += ship->width;
+		}
+
+		static GLint align = 0;
+
+		if (align == 0) {
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+		}
+
+		GLintptr at;
+		ShipDraw* draws = (ShipDraw*)universe->stream->alloc(n * sizeof(ShipDraw) + columns * sizeof(DrawCommand), align, at);
+		DrawCommand* commands = (DrawCommand*)(draws + n);
+		uint32_t drawn = 0, issued = 0, largest = 0;
+
+		for (Starship* ship : ships) {
+			mat4 mat = ship->transform(universe);
+			mat4 view = universe->viewMat * mat;
+			vec2 o = vec2(view[3].x, view[3].y), ax = vec2(view[0].x, view[0].y), ay = vec2(view[1].x, view[1].y);
+
+			if (!visible(o - ax - ay, ax * (float)(ship->width + 2), ay * (float)(ship->height + 2))) {
+				continue;
+			}
+
+			ship->frame(universe, mat);
+
+			uint32_t tiles = ship->width * ship->height;
+
+			if (ship->stale) {
+				copy(ship->handles, ship->handles + tiles, handles + ship->base);
+			} else {
+				for (uint32_t j : ship->dirty) {
+					handles[ship->base + j] = ship->handles[j];
+				}
+			}
+
+			ship->dirty.clear();
+			ship->stale = false;
+
+			uint32_t first = issued;
+
+			for (uint32_t x = 0; x < ship->width; x++) {
+				ivec2 rows = visible(o + ax * (float)x, ax, ay, ship->height);
+
+				if (rows.x >= rows.y) {
+					continue;
+				}
+
+				GLuint start = (x * ship->height + rows.x) * 6, count = (rows.y - rows.x) * 6;
+
+				if (issued > first && commands[issued - 1].first + commands[issued - 1].count == start) {
+					commands[issued - 1].count += count;
+				} else {
+					commands[issued++] = { count, 1, start, 0, drawn };
+				}
+			}
+
+			if (issued == first) {
+				continue;
+			}
+
+			draws[drawn++] = { mat, ship->base, ship->height };
+			largest = tiles > largest ? tiles : largest;
+		}
+
+		universe->stream->shrink(at, n * sizeof(ShipDraw) + issued * sizeof(DrawCommand));
+
+		if (issued != 0) {
+			index(largest);
+
+			glBindVertexArray(vao);
+			glUseProgram(universe->shipShader->id);
+
+			universe->shipShader->uView.set(universe->viewMat);
+
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, handleBuf);
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, universe->stream->id, at, drawn * sizeof(ShipDraw));
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, universe->stream->id);
+
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(at + n * sizeof(ShipDraw)), issued, 0);
+
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+			glUseProgram(0);
+			glBindVertexArray(0);
+		}
+
+		if (!freed.empty()) {
+			retired.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), freed });
+			freed.clear();
+		}
+
+		universe->spriteBatch.render(universe, universe->sprites);
+	}
+
+	bool FleetRenderer::visible(vec2 o, vec2 x, vec2 y) {
+		vec2 lo = o + vec2(x.x < 0 ? x.x : 0, x.y < 0 ? x.y : 0) + vec2(y.x < 0 ? y.x : 0, y.y < 0 ? y.y : 0);
+		vec2 hi = o + vec2(x.x > 0 ? x.x : 0, x.y > 0 ? x.y : 0) + vec2(y.x > 0 ? y.x : 0, y.y > 0 ? y.y : 0);
+
+		return lo.x < 1 && hi.x > -1 && lo.y < 1 && hi.y > -1;
+	}
+
+	ivec2 FleetRenderer::visible(vec2 o, vec2 x, vec2 y, uint32_t rows) {
+		float lo = 0, hi = (float)rows;
+
+		for (int axis = 0; axis < 2; axis++) {
+			float min = o[axis] + (x[axis] < 0 ? x[axis] : 0), max = o[axis] + (x[axis] > 0 ? x[axis] : 0);
+			float step = y[axis];
+
+			if (step > 0) {
+				max += step;
+			} else {
+				min += step;
+			}
+
+			if (step == 0) {
+				if (min >= 1 || max <= -1) {
+					return ivec2(0);
+				}
+
+				continue;
+			}
+
+			float a = (1 - min) / step, b = (-1 - max) / step;
+
+			if (step > 0) {
+				hi = a < hi ? a : hi;
+				lo = b > lo ? b : lo;
+			} else {
+				hi = b < hi ? b : hi;
+				lo = a > lo ? a : lo;
+			}
+		}
+
+		if (lo >= hi) {
+			return ivec2(0);
+		}
+
+		return ivec2((int)floor(lo), (int)ceil(hi));
+	}
+
+	bool FleetRenderer::reserve(Starship* ship) {
+		uint32_t tiles = ship->width * ship->height;
+
+		if (ship->reserved >= tiles) {
+			return false;
+		}
+
+		if (ship->reserved != 0) {
+			freed.push_back({ ship->base, ship->reserved });
+		}
+
+		ship->stale = true;
+		ship->reserved = tiles;
+
+		for (auto hole = holes.begin(); hole != holes.end(); hole++) {
+			if (hole->second >= tiles) {
+				ship->base = hole->first;
+				hole->first += tiles;
+				hole->second -= tiles;
+
+				if (hole->second == 0) {
+					holes.erase(hole);
+				}
+
+				return false;
+			}
+		}
+
+		ship->base = used;
+		used += tiles;
+
+		if (used <= capacity) {
+			return false;
+		}
+
+		grow(used * 2);
+		return true;
+	}
+
+	void FleetRenderer::reclaim() {
+		uint32_t done = 0;
+
+		for (; done < retired.size(); done++) {
+			GLenum status = glClientWaitSync(retired[done].fence, 0, 0);
+
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				break;
+			}
+
+			glDeleteSync(retired[done].fence);
+
+			for (auto& range : retired[done].ranges) {
+				release(range.first, range.second);
+			}
+		}
+
+		retired.erase(retired.begin(), retired.begin() + done);
+	}
+
+	void FleetRenderer::release(uint32_t base, uint32_t size) {
+		auto next = lower_bound(holes.begin(), holes.end(), pair<uint32_t, uint32_t>(base, 0));
+
+		if (next != holes.end() && base + size == next->first) {
+			size += next->second;
+			next = holes.erase(next);
+		}
+
+		if (next != holes.begin() && (next - 1)->first + (next - 1)->second == base) {
+			next--;
+			base = next->first;
+			size += next->second;
+			next = holes.erase(next);
+		}
+
+		if (base + size == used) {
+			used = base;
+			return;
+		}
+
+		holes.insert(next, { base, size });
+	}
+
+	void FleetRenderer::grow(uint32_t capacity) {
+		if (handleBuf != 0) {
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, handleBuf);
+			glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+			glDeleteBuffers(1, &handleBuf);
+		}
+
+		this->capacity = capacity;
+
+		glGenBuffers(1, &handleBuf);
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, handleBuf);
+		GLuint size = capacity * sizeof(GLuint64);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+		handles = (GLuint64*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	void FleetRenderer::index(uint32_t quads) {
+		if (quads <= this->quads) {
+			return;
+		}
+
+		this->quads = quads;
+
+		glBindVertexArray(vao);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, quads * 6 * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+
+		GLuint* eBuf = (GLuint*)glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
+
+		for (GLuint i = 0, j = 0; i < quads * 6; j += 4) {
+			eBuf[i++] = j + 0;
+			eBuf[i++] = j + 1;
+
+			eBuf[i++] = j + 2;
+			eBuf[i++] = j + 2;
+
+			eBuf[i++] = j + 3;
+			eBuf[i++] = j + 0;
+		}
+
+		glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+}
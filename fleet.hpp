@@ -0,0 +1,57 @@
+#pragma once
+
+#include "main.hpp"
+#include "argon.hpp"
+#include "glm/glm.hpp"
+
+using namespace Ar;
+using namespace glm;
+
+namespace He {
+	struct ShipDraw {
+	public:
+		mat4 mat;
+		GLuint base, height, pad[2] = {};
+	};
+
+	struct DrawCommand {
+	public:
+		GLuint count, instances, first;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	struct Retired {
+	public:
+		GLsync fence;
+		vector<pair<uint32_t, uint32_t>> ranges;
+	};
+
+	class FleetRenderer {
+	public:
+		GLuint vao = 0, ebo = 0, handleBuf = 0;
+		GLuint64* handles = nullptr;
+		uint32_t capacity = 0, used = 0, quads = 0;
+		vector<pair<uint32_t, uint32_t>> holes, freed;
+		vector<Retired> retired;
+
+		FleetRenderer();
+
+		void render(Universe* universe);
+
+	private:
+		bool visible(vec2 o, vec2 x, vec2 y);
+
+		ivec2 visible(vec2 o, vec2 x, vec2 y, uint32_t rows);
+
+		bool reserve(Starship* ship);
+
+		void reclaim();
+
+		void release(uint32_t base, uint32_t size);
+
+		void grow(uint32_t capacity);
+
+		void index(uint32_t quads);
+	};
+}
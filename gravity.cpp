@@ -0,0 +1,181 @@
+#pragma once
+
+#include "gravity.hpp"
+#include "physics.hpp"
+#include "universe.hpp"
+
+namespace He {
+	QuadNode::QuadNode(float cx, float cy, float half) : cx(cx), cy(cy), half(half), mass(0), mx(0), my(0), child(-1), body(-1) {}
+
+	void QuadTree::build(PhysicsWorld* world, int32_t originX, int32_t originY) {
+		this->world = world;
+		nodes.clear();
+		next.clear();
+
+		uint32_t n = world->size();
+
+		x.resize(n);
+		y.resize(n);
+		mass.assign(world->mass.begin(), world->mass.end());
+
+		for (uint32_t i = 0; i < n; i++) {
+			x[i] = (float)(world->sx[i] - originX) * PhysicsWorld::sectorSize + world->x[i];
+			y[i] = (float)(world->sy[i] - originY) * PhysicsWorld::sectorSize + world->y[i];
+		}
+
+		if (n == 0) {
+			return;
+		}
+
+		float minX = x[0], minY = y[0], maxX = minX, maxY = minY;
+
+		for (uint32_t i = 1; i < n; i++) {
+			minX = x[i] < minX ? x[i] : minX;
+			minY = y[i] < minY ? y[i] : minY;
+			maxX = x[i] > maxX ? x[i] : maxX;
+			maxY = y[i] > maxY ? y[i] : maxY;
+		}
+
+		float half = (maxX - minX > maxY - minY ? maxX - minX : maxY - minY) / 2 + 1;
+
+		nodes.reserve(n * 2);
+		nodes.push_back(QuadNode((minX + maxX) / 2, (minY + maxY) / 2, half));
+
+		next.resize(n, -1);
+
+		for (int32_t i = 0; i < (int32_t)n; i++) {
+			insert(i);
+		}
+	}
+
+	void QuadTree::insert(int32_t body) {
+		float x = this->x[body], y = this->y[body], mass = this->mass[body];
+		int32_t node = 0;
+
+		for (uint32_t depth = 0;; depth++) {
+			QuadNode& n = nodes[node];
+			n.mass += mass;
+			n.mx += mass * x;
+			n.my += mass * y;
+
+			if (n.child != -1) {
+				node = n.child + quadrant(node, x, y);
+				continue;
+			}
+
+			if (n.body == -1) {
+				n.body = body;
+				return;
+			}
+
+			if (depth >= maxDepth || (this->x[n.body] == x && this->y[n.body] == y)) {
+				next[body] = n.body;
+				n.body = body;
+				return;
+			}
+
+			subdivide(node);
+			node = nodes[node].child + quadrant(node, x, y);
+		}
+	}
+
+	void QuadTree::subdivide(int32_t node) {
+		int32_t child = (int32_t)nodes.size();
+		float cx = nodes[node].cx, cy = nodes[node].cy, half = nodes[node].half / 2;
+
+		nodes.push_back(QuadNode(cx - half, cy - half, half));
+		nodes.push_back(QuadNode(cx + half, cy - half, half));
+		nodes.push_back(QuadNode(cx - half, cy + half, half));
+		nodes.push_back(QuadNode(cx + half, cy + half, half));
+
+		int32_t body = nodes[node].body;
+		nodes[node].child = child;
+		nodes[node].body = -1;
+
+		while (body != -1) {
+			float x = this->x[body], y = this->y[body], mass = this->mass[body];
+			int32_t following = next[body];
+			QuadNode& c = nodes[child + quadrant(node, x, y)];
+
+			c.mass += mass;
+			c.mx += mass * x;
+			c.my += mass * y;
+			next[body] = c.body;
+			c.body = body;
+
+			body = following;
+		}
+	}
+
+	int32_t QuadTree::quadrant(int32_t node, float x, float y) {
+		const QuadNode& n = nodes[node];
+
+		return (x >= n.cx ? 1 : 0) | (y >= n.cy ? 2 : 0);
+	}
+
+	void QuadTree::apply(uint32_t begin, uint32_t end) {
+		if (nodes.empty()) {
+			return;
+		}
+
+		vector<float> lx, ly, lm;
+		int32_t stack[maxDepth * 3 + 4];
+
+		for (uint32_t i = begin; i < end; i++) {
+			float px = x[i], py = y[i];
+			uint32_t top = 0;
+			stack[top++] = 0;
+
+			lx.clear();
+			ly.clear();
+			lm.clear();
+
+			while (top != 0) {
+				const QuadNode& n = nodes[stack[--top]];
+
+				if (n.mass == 0) {
+					continue;
+				}
+
+				if (n.child == -1) {
+					for (int32_t body = n.body; body != -1; body = next[body]) {
+						lx.push_back(x[body]);
+						ly.push_back(y[body]);
+						lm.push_back(mass[body]);
+					}
+
+					continue;
+				}
+
+				float comX = n.mx / n.mass, comY = n.my / n.mass;
+				float diffX = comX - px, diffY = comY - py;
+				float dist = sqrt(diffX * diffX + diffY * diffY);
+				bool inside = abs(px - n.cx) <= n.half && abs(py - n.cy) <= n.half;
+
+				if (!inside && n.half * 2 < theta * dist) {
+					lx.push_back(comX);
+					ly.push_back(comY);
+					lm.push_back(n.mass);
+				} else {
+					for (int32_t c = 0; c < 4; c++) {
+						stack[top++] = n.child + c;
+					}
+				}
+			}
+
+			world->ax[i] = 0;
+			world->ay[i] = 0;
+
+			PhysicsWorld::accumulate(px, py, lx.data(), ly.data(), lm.data(), lx.size(), world->ax[i], world->ay[i]);
+		}
+	}
+
+	void QuadTree::direct(uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			world->ax[i] = 0;
+			world->ay[i] = 0;
+
+			PhysicsWorld::accumulate(x[i], y[i], x.data(), y.data(), mass.data(), x.size(), world->ax[i], world->ay[i]);
+		}
+	}
+}
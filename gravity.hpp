@@ -0,0 +1,42 @@
+#pragma once
+
+#include "main.hpp"
+#include "argon.hpp"
+
+using namespace Ar;
+
+namespace He {
+	class PhysicsWorld;
+
+	struct QuadNode {
+	public:
+		float cx, cy, half, mass, mx, my;
+		int32_t child, body;
+
+		QuadNode(float cx, float cy, float half);
+	};
+
+	class QuadTree {
+	public:
+		static constexpr uint32_t maxDepth = 32;
+
+		float theta = 0.5;
+		vector<QuadNode> nodes;
+		vector<int32_t> next;
+		vector<float> x, y, mass;
+		PhysicsWorld* world = nullptr;
+
+		void build(PhysicsWorld* world, int32_t originX, int32_t originY);
+
+		void apply(uint32_t begin, uint32_t end);
+
+		void direct(uint32_t begin, uint32_t end);
+
+	private:
+		void insert(int32_t body);
+
+		void subdivide(int32_t node);
+
+		int32_t quadrant(int32_t node, float x, float y);
+	};
+}
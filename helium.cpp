@@ -1,13 +1,17 @@
 #include "bitMath.hpp"
 #include "universe.hpp"
 #include "starship.hpp"
+#include "fleet.hpp"
 #include "tiles.hpp"
 #include "io.hpp"
+#include "bench.hpp"
+#include "shaders.hpp"
 
 #include "stb_image.h"
 #include "stackTrace.hpp"
 #include <sstream>
 #include <filesystem>
+#include <chrono>
 #include <iostream>
 
 using namespace std;
@@ -41,7 +45,32 @@ public:
 	}
 };
 
-int main() {
+int main(int argc, char** argv) {
+	if (argc > 1 && string(argv[1]) == "--bench") {
+		return runBenchmark(argc > 2 ? Scenario(argv[2]) : Scenario());
+	}
+
+	auto launch = chrono::steady_clock::now();
+	bool compute = false, dynamic = false, startup = false;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+
+		if (arg == "--compute-particles") {
+			compute = true;
+		} else if (arg == "--dynamic-resolution") {
+			dynamic = true;
+		} else if (arg == "--no-shader-cache") {
+			Program::cache.clear();
+		} else if (arg == "--startup-time") {
+			startup = true;
+		}
+	}
+
+	if (!startup) {
+		launch = {};
+	}
+
 	glfwSetErrorCallback([](int code, const char* desc) {
 		cout << "GLFW Error 0x" << toHex(code) << ": " << desc << endl;
 		});
@@ -82,27 +111,31 @@ int main() {
 
 	Universe universe = Universe(frame);
 
+	if (compute) {
+		universe.useCompute(1 << 20);
+	}
+
+	universe.resolution.enabled = dynamic;
+
 	string font = loadRes(L"times.ttf", RT_RCDATA);
 	nvgCreateFontMem(universe.vg, "times", (unsigned char*)font.data(), font.length(), false);
 
 	//universe.frame->children.addFirst(new FPSCounter(&universe));
-	//universe.masses.push_back(new OrbitalMass(0, 0, 0, 0, 5.97219e24));
+	//universe.objects.add(0, 0, 0, 0, 5.97219e24);
 
 	Starship ship(5, 8);
 
-	universe.objects.push_back(&ship.phys);
-
-	ship.phys.y = 0;
-	ship.phys.vx = 0;
-	ship.phys.mass = 5;
+	ship.phys = universe.objects.add(0);
+	universe.ships.push_back(&ship);
+	universe.focus = ship.phys;
 
 	stbi_set_flip_vertically_on_load(true);
 
-	PlatingTile plating;
+	PlatingTile plating(&universe);
 
-	EngineTile engine;
+	EngineTile engine(&universe);
 
-	TurretTile turret;
+	TurretTile turret(&universe);
 
 	ship.set(0, 0, &engine);
 	ship.set(0, 1, &plating);
@@ -143,9 +176,11 @@ int main() {
 	while (!glfwWindowShouldClose(universe.frame->handle)) {
 		glfwPollEvents();
 
+		ship.control(universe.frame->handle);
+
 		universe.startFrame();
 
-		ship.render(&universe);
+		universe.fleet->render(&universe);
 
 		/*
 		for (OrbitalMass* mass : universe.masses) {
@@ -182,6 +217,11 @@ int main() {
 		nvgEndFrame(universe.vg);
 
 		glfwSwapBuffers(universe.frame->handle);
+
+		if (launch != chrono::steady_clock::time_point()) {
+			cout << "First frame after " << chrono::duration<double, milli>(chrono::steady_clock::now() - launch).count() << " ms" << endl;
+			launch = {};
+		}
 	}
 
 	glfwDestroyWindow(universe.frame->handle);
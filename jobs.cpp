@@ -0,0 +1,155 @@
+#pragma once
+
+#include "jobs.hpp"
+
+namespace He {
+	JobSystem::JobSystem(uint32_t threads) {
+		start(threads);
+	}
+
+	JobSystem::~JobSystem() {
+		stop();
+	}
+
+	uint32_t JobSystem::threads() {
+		return queues.size();
+	}
+
+	void JobSystem::setThreads(uint32_t threads) {
+		stop();
+		start(threads);
+	}
+
+	void JobSystem::start(uint32_t threads) {
+		if (threads == 0) {
+			threads = thread::hardware_concurrency();
+		}
+
+		if (threads == 0) {
+			threads = 1;
+		}
+
+		running = true;
+
+		for (uint32_t i = 0; i < threads; i++) {
+			queues.push_back(new JobQueue());
+		}
+
+		for (uint32_t i = 1; i < threads; i++) {
+			workers.push_back(thread(&JobSystem::work, this, i));
+		}
+	}
+
+	void JobSystem::stop() {
+		{
+			lock_guard<mutex> guard(sleepLock);
+			running = false;
+		}
+
+		wake.notify_all();
+
+		for (thread& t : workers) {
+			t.join();
+		}
+
+		for (JobQueue* queue : queues) {
+			delete queue;
+		}
+
+		workers.clear();
+		queues.clear();
+	}
+
+	void JobSystem::parallelFor(uint32_t begin, uint32_t end, uint32_t grain, const function<void(uint32_t, uint32_t)>& fn) {
+		if (begin >= end) {
+			return;
+		}
+
+		if (grain == 0) {
+			grain = 1;
+		}
+
+		uint32_t chunks = (end - begin + grain - 1) / grain;
+
+		if (queues.size() == 1 || chunks == 1) {
+			fn(begin, end);
+			return;
+		}
+
+		atomic<uint32_t> remaining = chunks;
+
+		{
+			lock_guard<mutex> guard(sleepLock);
+			pending += chunks;
+		}
+
+		for (uint32_t c = 0; c < chunks; c++) {
+			uint32_t from = begin + c * grain;
+			uint32_t to = end - from < grain ? end : from + grain;
+			JobQueue* queue = queues[c % queues.size()];
+
+			lock_guard<mutex> guard(queue->lock);
+			queue->jobs.push_back(Job{ &fn, from, to, &remaining });
+		}
+
+		wake.notify_all();
+
+		while (remaining != 0) {
+			if (!runOne(0)) {
+				this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::work(uint32_t index) {
+		while (true) {
+			if (runOne(index)) {
+				continue;
+			}
+
+			unique_lock<mutex> guard(sleepLock);
+			wake.wait(guard, [this] { return pending != 0 || !running; });
+
+			if (!running) {
+				return;
+			}
+		}
+	}
+
+	bool JobSystem::runOne(uint32_t index) {
+		Job job;
+		bool found = false;
+
+		{
+			JobQueue* own = queues[index];
+			lock_guard<mutex> guard(own->lock);
+
+			if (!own->jobs.empty()) {
+				job = own->jobs.back();
+				own->jobs.pop_back();
+				found = true;
+			}
+		}
+
+		for (uint32_t i = 1; !found && i < queues.size(); i++) {
+			JobQueue* victim = queues[(index + i) % queues.size()];
+			lock_guard<mutex> guard(victim->lock);
+
+			if (!victim->jobs.empty()) {
+				job = victim->jobs.front();
+				victim->jobs.pop_front();
+				found = true;
+			}
+		}
+
+		if (!found) {
+			return false;
+		}
+
+		pending--;
+		(*job.fn)(job.begin, job.end);
+		(*job.remaining)--;
+
+		return true;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "main.hpp"
+#include "argon.hpp"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <condition_variable>
+
+using namespace Ar;
+
+namespace He {
+	struct Job {
+	public:
+		const function<void(uint32_t, uint32_t)>* fn;
+		uint32_t begin, end;
+		atomic<uint32_t>* remaining;
+	};
+
+	struct JobQueue {
+	public:
+		mutex lock;
+		deque<Job> jobs;
+	};
+
+	class JobSystem {
+	public:
+		JobSystem(uint32_t threads = 0);
+
+		~JobSystem();
+
+		uint32_t threads();
+
+		void setThreads(uint32_t threads);
+
+		void parallelFor(uint32_t begin, uint32_t end, uint32_t grain, const function<void(uint32_t, uint32_t)>& fn);
+
+	private:
+		vector<thread> workers;
+		vector<JobQueue*> queues;
+		atomic<uint32_t> pending = 0;
+		bool running = false;
+		mutex sleepLock;
+		condition_variable wake;
+
+		void start(uint32_t threads);
+
+		void stop();
+
+		void work(uint32_t index);
+
+		bool runOne(uint32_t index);
+	};
+}
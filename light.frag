@@ -1,18 +1,45 @@
-#version 460
-
-in vec2 fPos;
+#version 450
 
 out vec4 oCol;
 
-uniform vec4 uCol;
+const uint depth = 255;
+
+struct Light {
+	vec4 u, v, col, box;
+};
+
+layout(std430, binding = 0) readonly buffer Lights {
+	Light uLights[];
+};
+
+layout(std430, binding = 1) readonly buffer Tiles {
+	uint uLists[];
+};
+
+uniform uint uTiles;
 
 void main() {
-	float d = sqrt(fPos.x * fPos.x + fPos.y * fPos.y);
+	uvec2 t = uvec2(gl_FragCoord.xy) / 16;
+	uint tile = (t.y * uTiles + t.x) * (depth + 1);
+	uint n = uLists[tile];
+	vec3 p = vec3(gl_FragCoord.xy, 1);
+	vec3 col = vec3(0);
+
+	for (uint k = 1; k <= n; k++) {
+		Light light = uLights[uLists[tile + k]];
+
+		if (p.x < light.box.x || p.y < light.box.y || p.x > light.box.z || p.y > light.box.w) {
+			continue;
+		}
+
+		float d = length(vec2(dot(light.u.xyz, p), dot(light.v.xyz, p)));
+
+		if (light.col.a != 1) {
+			d = pow(d, light.col.a);
+		}
 
-	if (uCol.a != 1) {
-		d = pow(d, uCol.a);
+		col += clamp(light.col.rgb * (1 - d), 0, 1);
 	}
 
-	oCol = vec4(uCol.rgb * (1 - d), 1);
-	//gl_FragDepth = 2;
+	oCol = vec4(col, 1);
 }
\ No newline at end of file
@@ -15,5 +15,27 @@ namespace He {
 
 	struct Particle;
 
+	class ParticlePool;
+
+	class StreamBuffer;
+
+	class JobSystem;
+
 	class StarshipShader;
+
+	class SpriteShader;
+
+	class FleetRenderer;
+
+	class PostShader;
+
+	class LightShader;
+
+	class LightCullShader;
+
+	class ParticleShader;
+
+	class ParticleStateShader;
+
+	class ParticleComputeShader;
 }
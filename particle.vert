@@ -1,4 +1,4 @@
-#version 460
+#version 450
 
 layout(location = 0) in vec2 vPos;
 layout(location = 1) in vec4 vCol;
@@ -0,0 +1,44 @@
+#version 450
+
+struct Particle {
+	vec2 pos;
+	vec2 last;
+	vec2 vel;
+	float size;
+	float life;
+	vec4 col;
+	float maxLife;
+	uint behaviour;
+	uint seed;
+	float pad;
+};
+
+layout(std430, binding = 0) readonly buffer State {
+	Particle particles[];
+};
+
+out flat vec4 fCol;
+
+uniform mat4 uView;
+uniform float uZoom;
+uniform float uAlpha;
+uniform float uLod;
+
+void main() {
+	Particle p = particles[gl_VertexID];
+	float f = p.behaviour == 1 ? p.life / p.maxLife : 1;
+	float size = p.size * f, px = uZoom * size;
+
+	gl_Position = uView * vec4(mix(p.last, p.pos, uAlpha), 0, 1);
+	fCol = p.col * f;
+
+	if (px < uLod) {
+		if (float(p.seed >> 8) / 16777216.0 >= (px / uLod) * (px / uLod)) {
+			gl_Position = vec4(2, 2, 2, 1);
+		}
+
+		px = uLod;
+	}
+
+	gl_PointSize = px;
+}
\ No newline at end of file
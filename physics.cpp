@@ -3,31 +3,372 @@
 #include "physics.hpp"
 #include "universe.hpp"
 
+#include <immintrin.h>
+
+#if defined(__AVX__)
+#define HE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HE_SSE
+#endif
+
 namespace He {
-	PhysicsObject::PhysicsObject(float x, float y, float vx, float vy, float mass) : x(x), y(y), vx(vx), vy(vy), mass(mass) {}
+	PhysicsObject::PhysicsObject() : world(nullptr), id(0) {}
+
+	PhysicsObject::PhysicsObject(PhysicsWorld* world, uint32_t id) : world(world), id(id) {}
+
+	bool PhysicsObject::valid() {
+		return world != nullptr && id < world->slots.size() && world->slots[id] != UINT32_MAX;
+	}
+
+	uint32_t PhysicsObject::slot() {
+		return world->slots[id];
+	}
+
+	float& PhysicsObject::x() {
+		return world->x[slot()];
+	}
+
+	float& PhysicsObject::y() {
+		return world->y[slot()];
+	}
+
+	float& PhysicsObject::vx() {
+		return world->vx[slot()];
+	}
+
+	float& PhysicsObject::vy() {
+		return world->vy[slot()];
+	}
 
-	PhysicsObject::PhysicsObject(float x, float y, float mass) : x(x), y(y), vx(0), vy(0), mass(mass) {}
+	float& PhysicsObject::mass() {
+		return world->mass[slot()];
+	}
+
+	float& PhysicsObject::px() {
+		return world->px[slot()];
+	}
 
-	PhysicsObject::PhysicsObject(float mass) : x(0), y(0), vx(0), vy(0), mass(mass) {}
+	float& PhysicsObject::py() {
+		return world->py[slot()];
+	}
 
-	void PhysicsObject::update(PhysicsObject* other, Universe* universe) {
-		if (other->x != x && other->y != y) {
-			const float G = (6.67430e-11);
+	bool PhysicsObject::asleep() {
+		return slot() >= world->awake;
+	}
 
-			float diffX = other->x - x;
-			float diffY = other->y - y;
-			float distSq = diffX * diffX + diffY * diffY;
-			float dDist = sqrt(distSq);
+	void PhysicsObject::wake() {
+		world->wake(slot());
+	}
 
-			float force = G * mass * other->mass / distSq;
+	int32_t& PhysicsObject::sx() {
+		return world->sx[slot()];
+	}
 
-			vx += force / mass * diffX / dDist * universe->delta;
-			vy += force / mass * diffY / dDist * universe->delta;
+	int32_t& PhysicsObject::sy() {
+		return world->sy[slot()];
+	}
+
+	PhysicsObject PhysicsWorld::add(float x, float y, float vx, float vy, float mass) {
+		uint32_t id;
+
+		if (freeIds.empty()) {
+			id = slots.size();
+			slots.push_back(0);
+		} else {
+			id = freeIds.back();
+			freeIds.pop_back();
 		}
+
+		slots[id] = size();
+		owners.push_back(id);
+
+		this->x.push_back(x);
+		this->y.push_back(y);
+		this->vx.push_back(vx);
+		this->vy.push_back(vy);
+		this->mass.push_back(mass);
+		px.push_back(x);
+		py.push_back(y);
+		ax.push_back(0);
+		ay.push_back(0);
+		rest.push_back(0);
+		sx.push_back(0);
+		sy.push_back(0);
+		accelerated = false;
+
+		swapSlots(size() - 1, awake);
+		rebase(awake, awake + 1);
+		awake++;
+
+		return PhysicsObject(this, id);
 	}
 
-	void PhysicsObject::frame(Universe* universe) {
-		x += vx * universe->delta;
-		y += vy * universe->delta;
+	PhysicsObject PhysicsWorld::add(float x, float y, float mass) {
+		return add(x, y, 0, 0, mass);
+	}
+
+	PhysicsObject PhysicsWorld::add(float mass) {
+		return add(0, 0, 0, 0, mass);
+	}
+
+	void PhysicsWorld::remove(PhysicsObject obj) {
+		uint32_t i = obj.slot();
+
+		if (i < awake) {
+			swapSlots(i, --awake);
+			i = awake;
+		}
+
+		swapSlots(i, size() - 1);
+
+		x.pop_back();
+		y.pop_back();
+		vx.pop_back();
+		vy.pop_back();
+		mass.pop_back();
+		px.pop_back();
+		py.pop_back();
+		ax.pop_back();
+		ay.pop_back();
+		rest.pop_back();
+		sx.pop_back();
+		sy.pop_back();
+		owners.pop_back();
+
+		slots[obj.id] = UINT32_MAX;
+		freeIds.push_back(obj.id);
+	}
+
+	void PhysicsWorld::swapSlots(uint32_t i, uint32_t j) {
+		if (i == j) {
+			return;
+		}
+
+		swap(x[i], x[j]);
+		swap(y[i], y[j]);
+		swap(vx[i], vx[j]);
+		swap(vy[i], vy[j]);
+		swap(mass[i], mass[j]);
+		swap(px[i], px[j]);
+		swap(py[i], py[j]);
+		swap(ax[i], ax[j]);
+		swap(ay[i], ay[j]);
+		swap(rest[i], rest[j]);
+		swap(sx[i], sx[j]);
+		swap(sy[i], sy[j]);
+		swap(owners[i], owners[j]);
+
+		slots[owners[i]] = i;
+		slots[owners[j]] = j;
+	}
+
+	void PhysicsWorld::sleep(uint32_t i) {
+		if (i >= awake) {
+			return;
+		}
+
+		vx[i] = 0;
+		vy[i] = 0;
+		px[i] = x[i];
+		py[i] = y[i];
+
+		swapSlots(i, --awake);
+	}
+
+	void PhysicsWorld::wake(uint32_t i) {
+		if (i < awake) {
+			return;
+		}
+
+		rest[i] = 0;
+
+		swapSlots(i, awake++);
+	}
+
+	void PhysicsWorld::settle(float delta, float velocity, float acceleration, float time) {
+		for (uint32_t i = awake; i-- > 0;) {
+			float v = vx[i] * vx[i] + vy[i] * vy[i];
+			float a = ax[i] * ax[i] + ay[i] * ay[i];
+
+			if (v < velocity * velocity && a < acceleration * acceleration) {
+				rest[i] += delta;
+
+				if (rest[i] >= time) {
+					sleep(i);
+				}
+			} else {
+				rest[i] = 0;
+			}
+		}
+	}
+
+	uint32_t PhysicsWorld::size() {
+		return owners.size();
+	}
+
+	void PhysicsWorld::snapshot(uint32_t begin, uint32_t end) {
+		copy(x.begin() + begin, x.begin() + end, px.begin() + begin);
+		copy(y.begin() + begin, y.begin() + end, py.begin() + begin);
+	}
+
+	void PhysicsWorld::kick(uint32_t begin, uint32_t end, float delta) {
+		axpy(vx.data(), ax.data(), begin, end, delta);
+		axpy(vy.data(), ay.data(), begin, end, delta);
+	}
+
+	void PhysicsWorld::drift(uint32_t begin, uint32_t end, float delta) {
+		axpy(x.data(), vx.data(), begin, end, delta);
+		axpy(y.data(), vy.data(), begin, end, delta);
+	}
+
+	void PhysicsWorld::rebase(uint32_t begin, uint32_t end) {
+		const float half = sectorSize / 2;
+
+		for (uint32_t i = begin; i < end; i++) {
+			if (abs(x[i]) > half) {
+				int32_t shift = (int32_t)floor(x[i] / sectorSize + 0.5f);
+
+				x[i] -= shift * sectorSize;
+				px[i] -= shift * sectorSize;
+				sx[i] += shift;
+			}
+
+			if (abs(y[i]) > half) {
+				int32_t shift = (int32_t)floor(y[i] / sectorSize + 0.5f);
+
+				y[i] -= shift * sectorSize;
+				py[i] -= shift * sectorSize;
+				sy[i] += shift;
+			}
+		}
+	}
+
+	uint32_t PhysicsWorld::substeps(float delta, float eta, float length, uint32_t max) {
+		float step = delta;
+
+		for (uint32_t i = 0; i < size(); i++) {
+			float a = sqrt(ax[i] * ax[i] + ay[i] * ay[i]);
+
+			if (a == 0) {
+				continue;
+			}
+
+			float v = sqrt(vx[i] * vx[i] + vy[i] * vy[i]);
+			float t = v / a > sqrt(length / a) ? v / a : sqrt(length / a);
+
+			step = eta * t < step ? eta * t : step;
+		}
+
+		uint32_t n = (uint32_t)ceil(delta / step);
+
+		return n < 1 ? 1 : n > max ? max : n;
+	}
+
+	double PhysicsWorld::energy() {
+		double e = 0;
+
+		for (uint32_t i = 0; i < size(); i++) {
+			e += 0.5 * mass[i] * ((double)vx[i] * vx[i] + (double)vy[i] * vy[i]);
+
+			for (uint32_t j = i + 1; j < size(); j++) {
+				double dx = ((double)sx[j] - sx[i]) * sectorSize + x[j] - x[i], dy = ((double)sy[j] - sy[i]) * sectorSize + y[j] - y[i];
+				double dist = sqrt(dx * dx + dy * dy);
+
+				if (dist != 0) {
+					e -= G * mass[i] * mass[j] / dist;
+				}
+			}
+		}
+
+		return e;
+	}
+
+	void PhysicsWorld::axpy(float* y, const float* x, uint32_t begin, uint32_t end, float a) {
+		uint32_t i = begin;
+
+#if defined(HE_AVX)
+		__m256 s = _mm256_set1_ps(a);
+
+		for (; i + 8 <= end; i += 8) {
+			_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(x + i), s)));
+		}
+#elif defined(HE_SSE)
+		__m128 s = _mm_set1_ps(a);
+
+		for (; i + 4 <= end; i += 4) {
+			_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(x + i), s)));
+		}
+#endif
+
+		for (; i < end; i++) {
+			y[i] += x[i] * a;
+		}
+	}
+
+	void PhysicsWorld::accumulate(float px, float py, const float* ox, const float* oy, const float* om, uint32_t n, float& ax, float& ay) {
+		uint32_t i = 0;
+
+#if defined(HE_AVX)
+		__m256 x = _mm256_set1_ps(px), y = _mm256_set1_ps(py), g = _mm256_set1_ps(G);
+		__m256 sx = _mm256_setzero_ps(), sy = _mm256_setzero_ps();
+
+		for (; i + 8 <= n; i += 8) {
+			__m256 bx = _mm256_loadu_ps(ox + i), by = _mm256_loadu_ps(oy + i);
+			__m256 dx = _mm256_sub_ps(bx, x), dy = _mm256_sub_ps(by, y);
+			__m256 distSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+			__m256 s = _mm256_div_ps(_mm256_mul_ps(g, _mm256_loadu_ps(om + i)), _mm256_mul_ps(distSq, _mm256_sqrt_ps(distSq)));
+			__m256 mask = _mm256_and_ps(_mm256_cmp_ps(bx, x, _CMP_NEQ_UQ), _mm256_cmp_ps(by, y, _CMP_NEQ_UQ));
+
+			s = _mm256_and_ps(mask, s);
+			sx = _mm256_add_ps(sx, _mm256_mul_ps(s, dx));
+			sy = _mm256_add_ps(sy, _mm256_mul_ps(s, dy));
+		}
+
+		alignas(32) float lx[8], ly[8];
+		_mm256_store_ps(lx, sx);
+		_mm256_store_ps(ly, sy);
+
+		for (int j = 0; j < 8; j++) {
+			ax += lx[j];
+			ay += ly[j];
+		}
+#elif defined(HE_SSE)
+		__m128 x = _mm_set1_ps(px), y = _mm_set1_ps(py), g = _mm_set1_ps(G);
+		__m128 sx = _mm_setzero_ps(), sy = _mm_setzero_ps();
+
+		for (; i + 4 <= n; i += 4) {
+			__m128 bx = _mm_loadu_ps(ox + i), by = _mm_loadu_ps(oy + i);
+			__m128 dx = _mm_sub_ps(bx, x), dy = _mm_sub_ps(by, y);
+			__m128 distSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+			__m128 s = _mm_div_ps(_mm_mul_ps(g, _mm_loadu_ps(om + i)), _mm_mul_ps(distSq, _mm_sqrt_ps(distSq)));
+			__m128 mask = _mm_and_ps(_mm_cmpneq_ps(bx, x), _mm_cmpneq_ps(by, y));
+
+			s = _mm_and_ps(mask, s);
+			sx = _mm_add_ps(sx, _mm_mul_ps(s, dx));
+			sy = _mm_add_ps(sy, _mm_mul_ps(s, dy));
+		}
+
+		alignas(16) float lx[4], ly[4];
+		_mm_store_ps(lx, sx);
+		_mm_store_ps(ly, sy);
+
+		for (int j = 0; j < 4; j++) {
+			ax += lx[j];
+			ay += ly[j];
+		}
+#endif
+
+		for (; i < n; i++) {
+			if (ox[i] != px && oy[i] != py) {
+				float diffX = ox[i] - px;
+				float diffY = oy[i] - py;
+				float distSq = diffX * diffX + diffY * diffY;
+
+				float s = G * om[i] / (distSq * sqrt(distSq));
+
+				ax += s * diffX;
+				ay += s * diffY;
+			}
+		}
 	}
 }
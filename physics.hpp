@@ -1,20 +1,92 @@
 #pragma once
 
 #include "main.hpp"
+#include "argon.hpp"
+
+using namespace Ar;
 
 namespace He {
+	class PhysicsWorld;
+
 	class PhysicsObject {
 	public:
-		float x, y, vx, vy, mass;
+		PhysicsWorld* world;
+		uint32_t id;
+
+		PhysicsObject();
+
+		PhysicsObject(PhysicsWorld* world, uint32_t id);
+
+		bool valid();
+
+		uint32_t slot();
+
+		float& x();
+
+		float& y();
+
+		float& vx();
+
+		float& vy();
+
+		float& mass();
+
+		float& px();
+
+		float& py();
+
+		bool asleep();
+
+		void wake();
+
+		int32_t& sx();
+
+		int32_t& sy();
+	};
+
+	class PhysicsWorld {
+	public:
+		static constexpr float G = 6.67430e-11;
+		static constexpr float sectorSize = 1024;
+
+		vector<float> x, y, vx, vy, mass, px, py, ax, ay, rest;
+		vector<int32_t> sx, sy;
+		vector<uint32_t> owners, slots, freeIds;
+		uint32_t awake = 0;
+		bool accelerated = false;
+
+		PhysicsObject add(float x, float y, float vx, float vy, float mass);
+
+		PhysicsObject add(float x, float y, float mass);
+
+		PhysicsObject add(float mass);
+
+		void remove(PhysicsObject obj);
+
+		uint32_t size();
+
+		void swapSlots(uint32_t i, uint32_t j);
+
+		void sleep(uint32_t i);
+
+		void wake(uint32_t i);
+
+		void settle(float delta, float velocity, float acceleration, float time);
+
+		void snapshot(uint32_t begin, uint32_t end);
+
+		void kick(uint32_t begin, uint32_t end, float delta);
+
+		void drift(uint32_t begin, uint32_t end, float delta);
 
-		PhysicsObject(float x, float y, float vx, float vy, float mass);
+		void rebase(uint32_t begin, uint32_t end);
 
-		PhysicsObject(float x, float y, float mass);
+		uint32_t substeps(float delta, float eta, float length, uint32_t max);
 
-		PhysicsObject(float mass);
+		double energy();
 
-		void update(PhysicsObject* other, Universe* universe);
+		static void axpy(float* y, const float* x, uint32_t begin, uint32_t end, float a);
 
-		void frame(Universe* universe);
+		static void accumulate(float px, float py, const float* ox, const float* oy, const float* om, uint32_t n, float& ax, float& ay);
 	};
 }
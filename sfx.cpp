@@ -2,93 +2,511 @@
 
 #include "sfx.hpp"
 #include "universe.hpp"
-#include "io.hpp"
+#include "shaders.hpp"
+#include "physics.hpp"
+#include "stream.hpp"
+#include "jobs.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
 namespace He {
 	Light::Light(mat4 mat, GLfloat r, GLfloat g, GLfloat b, GLfloat a) : mat(mat), r(r), g(g), b(b), a(a) {}
 
-	void Light::render(Universe* universe) {
-		static GLuint vao = 0, vbo = 0, ebo = 0;
-		static Shader shader;
+	void LightGrid::render(Universe* universe, const vector<Light>& lights) {
+		if (program == nullptr) {
+			program = new LightCullShader();
+			shader = new LightShader();
+		}
 
-		if (vao == 0) {
-			glGenVertexArrays(1, &vao);
+		if (lights.empty()) {
+			return;
+		}
 
-			glBindVertexArray(vao);
+		uint32_t width = universe->target.width, height = universe->target.height;
 
-			glGenBuffers(1, &vbo);
+		resize(width, height);
 
-			glBindBuffer(GL_ARRAY_BUFFER, vbo);
-			glBufferData(GL_ARRAY_BUFFER, 8 * sizeof(GLubyte), nullptr, GL_STATIC_DRAW);
-			GLubyte* buf = (GLubyte*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+		static GLint align = 0;
 
-			buf[0] = 0;
-			buf[1] = 0;
-			buf[2] = 1;
-			buf[3] = 0;
-			buf[4] = 1;
-			buf[5] = 1;
-			buf[6] = 0;
-			buf[7] = 1;
+		if (align == 0) {
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+		}
 
-			glUnmapBuffer(GL_ARRAY_BUFFER);
-			glVertexAttribPointer(0, 2, GL_UNSIGNED_BYTE, false, 0, 0);
-			glEnableVertexAttribArray(0);
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		GLintptr at;
+		GpuLight* out = (GpuLight*)universe->stream->alloc(lights.size() * sizeof(GpuLight), align, at);
+		float hw = width / 2.0f, hh = height / 2.0f;
+		GLuint count = 0;
 
-			glGenBuffers(1, &ebo);
+		for (const Light& l : lights) {
+			mat4 m = universe->viewMat * l.mat;
 
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * sizeof(GLubyte), nullptr, GL_STATIC_DRAW);
-			buf = (GLubyte*)glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
+			float a = m[0][0] * hw, b = m[1][0] * hw, c = m[0][1] * hh, d = m[1][1] * hh;
+			float tx = (m[3][0] + 1) * hw, ty = (m[3][1] + 1) * hh;
+			float det = a * d - b * c;
 
-			buf[0] = 0;
-			buf[1] = 1;
-			buf[2] = 2;
-			buf[3] = 2;
-			buf[4] = 3;
-			buf[5] = 0;
+			if (det == 0) {
+				continue;
+			}
 
-			glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			float minX = tx + (a < 0 ? a : 0) + (b < 0 ? b : 0), maxX = tx + (a > 0 ? a : 0) + (b > 0 ? b : 0);
+			float minY = ty + (c < 0 ? c : 0) + (d < 0 ? d : 0), maxY = ty + (c > 0 ? c : 0) + (d > 0 ? d : 0);
 
-			glBindVertexArray(0);
+			if (maxX <= 0 || maxY <= 0 || minX >= width || minY >= height) {
+				continue;
+			}
 
-			shader.attach(GL_VERTEX_SHADER, loadRes(L"light.vert", RT_RCDATA));
-			shader.attach(GL_FRAGMENT_SHADER, loadRes(L"light.frag", RT_RCDATA));
-			shader.link();
+			float ia = 2 * d / det, ib = -2 * b / det, ic = -2 * c / det, id = 2 * a / det;
+
+			out[count++] = { vec4(ia, ib, -ia * tx - ib * ty - 1, 0), vec4(ic, id, -ic * tx - id * ty - 1, 0), vec4(l.r, l.g, l.b, l.a), vec4(minX, minY, maxX, maxY) };
 		}
 
+		universe->stream->shrink(at, count * sizeof(GpuLight));
+
+		if (count == 0) {
+			return;
+		}
+
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, universe->stream->id, at, count * sizeof(GpuLight));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, lists);
+
+		glUseProgram(program->id);
+
+		program->uCount.set(count);
+
+		glDispatchCompute(tilesX, tilesY, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		glBindVertexArray(universe->vao);
+		glUseProgram(shader->id);
+
+		shader->uTiles.set(tilesX);
+
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+
+		glUseProgram(0);
+		glBindVertexArray(0);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+	}
+
+	void LightGrid::resize(uint32_t width, uint32_t height) {
+		uint32_t x = (width + tile - 1) / tile, y = (height + tile - 1) / tile;
+
+		if (x == tilesX && y == tilesY) {
+			return;
+		}
+
+		tilesX = x;
+		tilesY = y;
+
+		if (lists == 0) {
+			glGenBuffers(1, &lists);
+		}
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lists);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, x * y * (depth + 1) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	Random::Random(uint64_t seed) : state(seed) {}
+
+	uint64_t Random::next() {
+		uint64_t z = state += 0x9E3779B97F4A7C15;
+
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+
+		return z ^ (z >> 31);
+	}
+
+	float Random::uniform(float min, float max) {
+		return min + (max - min) * ((next() >> 40) * (1.0f / (1 << 24)));
+	}
+
+	float Random::uniform(Range range) {
+		return uniform(range.min, range.max);
+	}
+
+	Sprite::Sprite(mat4 mat, GLuint64 texture) : mat(mat), texture(texture) {}
+
+	void SpriteBatch::render(Universe* universe, const vector<Sprite>& sprites) {
+		if (vao == 0) {
+			init();
+		}
+
+		if (sprites.empty()) {
+			return;
+		}
+
+		GLintptr at;
+
+		copy(sprites.begin(), sprites.end(), (Sprite*)universe->stream->alloc(sprites.size() * sizeof(Sprite), sizeof(Sprite), at));
+
 		glBindVertexArray(vao);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glUseProgram(shader.id);
+		glBindVertexBuffer(1, universe->stream->id, at, sizeof(Sprite));
+		glUseProgram(shader->id);
 
-		glUniformMatrix4fv(glGetUniformLocation(shader.id, "uView"), 1, false, value_ptr(universe->viewMat));
-		glUniformMatrix4fv(glGetUniformLocation(shader.id, "uMat"), 1, false, value_ptr(mat));
-		glUniform4f(glGetUniformLocation(shader.id, "uCol"), r, g, b, a);
+		shader->uView.set(universe->viewMat);
 
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
+		glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, sprites.size());
 
 		glUseProgram(0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 		glBindVertexArray(0);
 	}
 
-	Particle::Particle(vec2 pos, vec4 col, GLfloat size, function<void(Particle*, Universe*)> updater, float life) : pos(pos), col(col), size(size), updater(updater), life(life), maxLife(life) {}
+	void SpriteBatch::init() {
+		glGenVertexArrays(1, &vao);
+
+		glBindVertexArray(vao);
+
+		glGenBuffers(1, &vbo);
+
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, 8 * sizeof(GLubyte), nullptr, GL_STATIC_DRAW);
+		GLubyte* buf = (GLubyte*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+
+		buf[0] = 0;
+		buf[1] = 0;
+		buf[2] = 0;
+		buf[3] = 1;
+		buf[4] = 1;
+		buf[5] = 1;
+		buf[6] = 1;
+		buf[7] = 0;
+
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glVertexAttribPointer(0, 2, GL_UNSIGNED_BYTE, false, 0, 0);
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		for (GLuint i = 0; i < 4; i++) {
+			glVertexAttribFormat(1 + i, 4, GL_FLOAT, false, offsetof(Sprite, mat) + i * sizeof(vec4));
+			glVertexAttribBinding(1 + i, 1);
+			glEnableVertexAttribArray(1 + i);
+		}
+
+		glVertexAttribIFormat(5, 2, GL_UNSIGNED_INT, offsetof(Sprite, texture));
+		glVertexAttribBinding(5, 1);
+		glEnableVertexAttribArray(5);
+
+		glVertexBindingDivisor(1, 1);
+
+		glGenBuffers(1, &ebo);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * sizeof(GLubyte), nullptr, GL_STATIC_DRAW);
+		buf = (GLubyte*)glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
+
+		buf[0] = 0;
+		buf[1] = 1;
+		buf[2] = 2;
+		buf[3] = 2;
+		buf[4] = 3;
+		buf[5] = 0;
+
+		glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		glBindVertexArray(0);
+
+		shader = new SpriteShader();
+	}
+
+	Particle::Particle(vec2 pos, vec2 vel, vec4 col, GLfloat size, float life, Behaviour behaviour, uint32_t seed) : pos(pos), vel(vel), col(col), size(size), life(life), behaviour(behaviour), seed(seed) {}
+
+	void ParticlePool::add(const Particle& p) {
+		x.push_back(p.pos.x);
+		y.push_back(p.pos.y);
+		lx.push_back(p.pos.x);
+		ly.push_back(p.pos.y);
+		vx.push_back(p.vel.x);
+		vy.push_back(p.vel.y);
+		size.push_back(p.size);
+		life.push_back(p.life);
+		maxLife.push_back(p.life);
+		col.push_back(p.col);
+		behaviour.push_back(p.behaviour);
+		seed.push_back(p.seed);
+	}
+
+	void ParticlePool::reserve(uint32_t n) {
+		x.reserve(n);
+		y.reserve(n);
+		lx.reserve(n);
+		ly.reserve(n);
+		vx.reserve(n);
+		vy.reserve(n);
+		size.reserve(n);
+		life.reserve(n);
+		maxLife.reserve(n);
+		col.reserve(n);
+		behaviour.reserve(n);
+		seed.reserve(n);
+	}
+
+	void ParticlePool::resize(uint32_t n) {
+		x.resize(n);
+		y.resize(n);
+		lx.resize(n);
+		ly.resize(n);
+		vx.resize(n);
+		vy.resize(n);
+		size.resize(n);
+		life.resize(n);
+		maxLife.resize(n);
+		col.resize(n);
+		behaviour.resize(n);
+		seed.resize(n);
+	}
+
+	uint32_t ParticlePool::count() {
+		return x.size();
+	}
+
+	void ParticlePool::update(float delta, JobSystem& jobs) {
+		uint32_t n = count(), chunks = (n + chunk - 1) / chunk;
+
+		kept.assign(chunks, 0);
+
+		jobs.parallelFor(0, chunks, 1, [this, delta, n](uint32_t begin, uint32_t end) {
+			for (uint32_t c = begin; c < end; c++) {
+				uint32_t from = c * chunk, to = from + chunk < n ? from + chunk : n;
+
+				copy(x.begin() + from, x.begin() + to, lx.begin() + from);
+				copy(y.begin() + from, y.begin() + to, ly.begin() + from);
+
+				PhysicsWorld::axpy(x.data(), vx.data(), from, to, delta);
+				PhysicsWorld::axpy(y.data(), vy.data(), from, to, delta);
 
-	bool Particle::frame(Universe* universe) {
-		if (maxLife != 0) {
-			life -= universe->delta;
+				for (uint32_t i = from; i < to;) {
+					if (maxLife[i] != 0) {
+						life[i] -= delta;
 
-			if (life <= 0) {
-				return false;
+						if (life[i] <= 0) {
+							move(--to, *this, i);
+							continue;
+						}
+					}
+
+					i++;
+				}
+
+				kept[c] = to - from;
+			}
+			});
+
+		uint32_t total = 0;
+
+		for (uint32_t c = 0; c < chunks; c++) {
+			total += kept[c];
+		}
+
+		uint32_t source = chunks, s = 0, sEnd = 0;
+
+		for (uint32_t c = 0; c < chunks && c * chunk + kept[c] < total; c++) {
+			uint32_t hole = c * chunk + kept[c], holeEnd = (c + 1) * chunk < total ? (c + 1) * chunk : total;
+
+			for (; hole < holeEnd; hole++) {
+				while (sEnd <= s) {
+					source--;
+					s = source * chunk > total ? source * chunk : total;
+					sEnd = source * chunk + kept[source];
+				}
+
+				move(--sEnd, *this, hole);
+			}
+		}
+
+		resize(total);
+	}
+
+	void ParticlePool::shift(vec2 by) {
+		for (uint32_t i = 0; i < count(); i++) {
+			x[i] += by.x;
+			y[i] += by.y;
+			lx[i] += by.x;
+			ly[i] += by.y;
+		}
+	}
+
+	vec4 ParticlePool::colour(uint32_t i) {
+		switch (behaviour[i]) {
+		case Behaviour::Fade:
+			return col[i] * (life[i] / maxLife[i]);
+		default:
+			return col[i];
+		}
+	}
+
+	GLfloat ParticlePool::pointSize(uint32_t i) {
+		switch (behaviour[i]) {
+		case Behaviour::Fade:
+			return size[i] * (life[i] / maxLife[i]);
+		default:
+			return size[i];
+		}
+	}
+
+	uint32_t ParticlePool::gather(ParticleVertex* out, mat4 view, vec2 viewport, float zoom, float alpha, float lod) {
+		uint32_t k = 0;
+
+		for (uint32_t i = 0; i < count(); i++) {
+			vec2 pos = vec2(mix(lx[i], x[i], alpha), mix(ly[i], y[i], alpha));
+			GLfloat s = pointSize(i), px = s * zoom;
+			float cx = view[0][0] * pos.x + view[1][0] * pos.y + view[3][0], cy = view[0][1] * pos.x + view[1][1] * pos.y + view[3][1];
+			float rx = px / viewport.x, ry = px / viewport.y;
+
+			if (cx < -1 - rx || cx > 1 + rx || cy < -1 - ry || cy > 1 + ry) {
+				continue;
+			}
+
+			if (px < lod) {
+				if ((seed[i] >> 8) * (1.0f / (1 << 24)) >= (px / lod) * (px / lod)) {
+					continue;
+				}
+
+				s = lod / zoom;
+			}
+
+			out[k++] = { pos, colour(i), s };
+		}
+
+		return k;
+	}
+
+	void ParticlePool::move(uint32_t from, ParticlePool& to, uint32_t at) {
+		to.x[at] = x[from];
+		to.y[at] = y[from];
+		to.lx[at] = lx[from];
+		to.ly[at] = ly[from];
+		to.vx[at] = vx[from];
+		to.vy[at] = vy[from];
+		to.size[at] = size[from];
+		to.life[at] = life[from];
+		to.maxLife[at] = maxLife[from];
+		to.col[at] = col[from];
+		to.behaviour[at] = behaviour[from];
+		to.seed[at] = seed[from];
+	}
+
+	void GpuParticlePool::init(uint32_t capacity) {
+		this->capacity = capacity;
+
+		const GLuint reset[7] = { 0, 1, 0, 0, 0, 1, 1 };
+
+		glGenBuffers(2, state);
+		glGenBuffers(2, counters);
+
+		for (uint32_t i = 0; i < 2; i++) {
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, state[i]);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(GpuParticle), nullptr, GL_DYNAMIC_DRAW);
+
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, counters[i]);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(reset), reset, GL_DYNAMIC_DRAW);
+		}
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		glGenVertexArrays(1, &vao);
+
+		program = new ParticleComputeShader();
+		shader = new ParticleStateShader();
+	}
+
+	void GpuParticlePool::add(const Particle& p) {
+		spawns.push_back({ p.pos, p.pos, p.vel, p.size, p.life, p.col, p.life, (GLuint)p.behaviour, p.seed, 0 });
+	}
+
+	void GpuParticlePool::shift(vec2 by) {
+		pending += by;
+
+		for (GpuParticle& p : spawns) {
+			p.pos += by;
+			p.last += by;
+		}
+	}
+
+	void GpuParticlePool::update(float delta, StreamBuffer* stream) {
+		const GLuint reset[7] = { 0, 1, 0, 0, 0, 1, 1 };
+		uint32_t next = current ^ 1;
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, counters[next]);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(reset), reset);
+
+		glUseProgram(program->id);
+
+		program->uCapacity.set(capacity);
+		program->uDelta.set(delta);
+		program->uShift.set(pending);
+		program->uSpawn.set(0);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, state[current]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, state[next]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, counters[current]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, counters[next]);
+
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, counters[current]);
+		glDispatchComputeIndirect(4 * sizeof(GLuint));
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+		if (!spawns.empty()) {
+			static GLint align = 0;
+
+			if (align == 0) {
+				glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
 			}
+
+			uint32_t n = spawns.size();
+			GLintptr at;
+
+			copy(spawns.begin(), spawns.end(), (GpuParticle*)stream->alloc(n * sizeof(GpuParticle), align, at));
+
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+			program->uSpawn.set(1);
+			program->uCount.set(n);
+			program->uShift.set(vec2(0));
+
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, stream->id, at, n * sizeof(GpuParticle));
+			glDispatchCompute((n + groupSize - 1) / groupSize, 1, 1);
+
+			spawns.clear();
+		}
+
+		for (uint32_t i = 0; i < 4; i++) {
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
 		}
 
-		updater(this, universe);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glUseProgram(0);
+
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
 
-		return true;
+		current = next;
+		pending = vec2(0);
+	}
+
+	void GpuParticlePool::render(mat4 view, float zoom, float alpha, float lod) {
+		glBindVertexArray(vao);
+		glUseProgram(shader->id);
+
+		shader->uView.set(view);
+		shader->uZoom.set(zoom);
+		shader->uAlpha.set(alpha);
+		shader->uLod.set(lod);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, state[current]);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, counters[current]);
+
+		glDrawArraysIndirect(GL_POINTS, 0);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+		glUseProgram(0);
+		glBindVertexArray(0);
 	}
 }
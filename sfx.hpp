@@ -14,20 +14,171 @@ namespace He {
 		GLfloat r, g, b, a;
 
 		Light(mat4 mat, GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+	};
+
+	struct GpuLight {
+	public:
+		vec4 u, v, col, box;
+	};
+
+	class LightGrid {
+	public:
+		static constexpr uint32_t tile = 16, depth = 255;
+
+		GLuint lists = 0;
+		uint32_t tilesX = 0, tilesY = 0;
+		LightCullShader* program = nullptr;
+		LightShader* shader = nullptr;
+
+		void render(Universe* universe, const vector<Light>& lights);
+
+	private:
+		void resize(uint32_t width, uint32_t height);
+	};
+
+	struct Sprite {
+	public:
+		mat4 mat;
+		GLuint64 texture;
+
+		Sprite(mat4 mat, GLuint64 texture);
+	};
+
+	class SpriteBatch {
+	public:
+		GLuint vao = 0, vbo = 0, ebo = 0;
+		SpriteShader* shader = nullptr;
+
+		void render(Universe* universe, const vector<Sprite>& sprites);
 
-		void render(Universe* universe);
+	private:
+		void init();
+	};
+
+	enum class Behaviour : uint8_t {
+		Drift,
+		Fade
 	};
 
 	struct Particle {
+	public:
+		vec2 pos, vel;
+		vec4 col;
+		GLfloat size;
+		float life;
+		Behaviour behaviour;
+		uint32_t seed;
+
+		Particle(vec2 pos, vec2 vel, vec4 col, GLfloat size, float life = 0, Behaviour behaviour = Behaviour::Drift, uint32_t seed = 0);
+	};
+
+	struct Range {
+	public:
+		float min, max;
+	};
+
+	struct Random {
+	public:
+		uint64_t state;
+
+		Random(uint64_t seed = 0);
+
+		uint64_t next();
+
+		float uniform(float min, float max);
+
+		float uniform(Range range);
+	};
+
+	struct EmitterDesc {
+	public:
+		float rate, inherit;
+		vec4 from, to;
+		Range alpha, size, life, jitter;
+		Behaviour behaviour;
+	};
+
+	struct EmitterState {
+	public:
+		Random random;
+		float accumulator = 0;
+	};
+
+	struct Emission {
+	public:
+		const EmitterDesc* desc;
+		EmitterState* state;
+		vec2 pos, vel;
+	};
+
+	struct ParticleVertex {
 	public:
 		vec2 pos;
 		vec4 col;
 		GLfloat size;
-		function<void(Particle*, Universe*)> updater;
-		float maxLife, life;
+	};
+
+	class ParticlePool {
+	public:
+		static constexpr uint32_t chunk = 16384;
+
+		vector<float> x, y, lx, ly, vx, vy, size, life, maxLife;
+		vector<vec4> col;
+		vector<Behaviour> behaviour;
+		vector<uint32_t> seed, kept;
+
+		void add(const Particle& p);
+
+		void reserve(uint32_t n);
+
+		void resize(uint32_t n);
+
+		uint32_t count();
+
+		void update(float delta, JobSystem& jobs);
+
+		void shift(vec2 by);
+
+		vec4 colour(uint32_t i);
+
+		GLfloat pointSize(uint32_t i);
+
+		uint32_t gather(ParticleVertex* out, mat4 view, vec2 viewport, float zoom, float alpha, float lod);
+
+	private:
+		void move(uint32_t from, ParticlePool& to, uint32_t at);
+	};
+
+	struct GpuParticle {
+	public:
+		vec2 pos, last, vel;
+		GLfloat size;
+		float life;
+		vec4 col;
+		float maxLife;
+		GLuint behaviour, seed;
+		GLfloat pad;
+	};
+
+	class GpuParticlePool {
+	public:
+		static constexpr uint32_t groupSize = 256;
+
+		uint32_t capacity = 0, current = 0;
+		GLuint state[2] = {}, counters[2] = {}, vao = 0;
+		ParticleComputeShader* program = nullptr;
+		ParticleStateShader* shader = nullptr;
+		vector<GpuParticle> spawns;
+		vec2 pending = vec2(0);
+
+		void init(uint32_t capacity);
+
+		void add(const Particle& p);
+
+		void shift(vec2 by);
 
-		Particle(vec2 pos, vec4 col, GLfloat size, function<void(Particle*, Universe*)> updater, float life = 0);
+		void update(float delta, StreamBuffer* stream);
 
-		bool frame(Universe* universe);
+		void render(mat4 view, float zoom, float alpha, float lod);
 	};
 }
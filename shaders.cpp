@@ -2,11 +2,190 @@
 
 #include "shaders.hpp"
 #include "io.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 
 namespace He {
-	StarshipShader::StarshipShader() : Shader() {
+	template<> void Uniform<GLint>::set(const GLint& value) {
+		glProgramUniform1i(program, location, value);
+	}
+
+	template<> void Uniform<GLuint>::set(const GLuint& value) {
+		glProgramUniform1ui(program, location, value);
+	}
+
+	template<> void Uniform<GLfloat>::set(const GLfloat& value) {
+		glProgramUniform1f(program, location, value);
+	}
+
+	template<> void Uniform<vec2>::set(const vec2& value) {
+		glProgramUniform2f(program, location, value.x, value.y);
+	}
+
+	template<> void Uniform<mat4>::set(const mat4& value) {
+		glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, value_ptr(value));
+	}
+
+	void Program::attach(GLenum type, string source) {
+		sources.push_back({ type, source });
+	}
+
+	void Program::link() {
+		uint64_t hash = 14695981039346656037ull;
+
+		auto mix = [&hash](const string& s) {
+			for (char c : s) {
+				hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+			}
+		};
+
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+			mix((const char*)glGetString(name));
+		}
+
+		for (auto& [type, source] : sources) {
+			mix(to_string(type));
+			mix(source);
+		}
+
+		stringstream file;
+		file << hex << hash << ".bin";
+
+		filesystem::path path = cache / file.str();
+
+		if (id == 0) {
+			id = glCreateProgram();
+		}
+
+		if (!cache.empty()) {
+			ifstream in(path, ios::binary);
+			GLenum format = 0;
+
+			GLint count = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+
+			vector<GLint> formats(count);
+			glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+
+			if (in.read((char*)&format, sizeof(format)) && find(formats.begin(), formats.end(), (GLint)format) != formats.end()) {
+				string binary((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+				GLint status = 0;
+
+				glProgramBinary(id, format, binary.data(), binary.size());
+				glGetProgramiv(id, GL_LINK_STATUS, &status);
+
+				if (status == GL_TRUE) {
+					sources.clear();
+					return;
+				}
+			}
+		}
+
+		for (auto& [type, source] : sources) {
+			Shader::attach(type, source);
+		}
+
+		sources.clear();
+
+		glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+		Shader::link();
+
+		GLint length = 0;
+		glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+
+		if (cache.empty() || length == 0) {
+			return;
+		}
+
+		string binary(length, 0);
+		GLenum format = 0;
+
+		glGetProgramBinary(id, length, nullptr, &format, binary.data());
+
+		error_code error;
+		filesystem::create_directories(cache, error);
+
+		ofstream out(path, ios::binary);
+		out.write((char*)&format, sizeof(format));
+		out.write(binary.data(), binary.size());
+
+		if (!out) {
+			cerr << "Unable to write program cache " << path.string() << endl;
+		}
+	}
+
+	StarshipShader::StarshipShader() : Program() {
 		attach(GL_VERTEX_SHADER, loadRes(L"starship.vert", RT_RCDATA));
 		attach(GL_FRAGMENT_SHADER, loadRes(L"starship.frag", RT_RCDATA));
 		link();
+
+		uView = uniform<mat4>("uView");
+	}
+
+	SpriteShader::SpriteShader() : Program() {
+		attach(GL_VERTEX_SHADER, loadRes(L"sprite.vert", RT_RCDATA));
+		attach(GL_FRAGMENT_SHADER, loadRes(L"sprite.frag", RT_RCDATA));
+		link();
+
+		uView = uniform<mat4>("uView");
+	}
+
+	PostShader::PostShader() : Program() {
+		attach(GL_VERTEX_SHADER, loadRes(L"post.vert", RT_RCDATA));
+		attach(GL_FRAGMENT_SHADER, loadRes(L"post.frag", RT_RCDATA));
+		link();
+
+		uTex = uniform<GLint>("uTex");
+		uScale = uniform<vec2>("uScale");
+	}
+
+	LightShader::LightShader() : Program() {
+		attach(GL_VERTEX_SHADER, loadRes(L"post.vert", RT_RCDATA));
+		attach(GL_FRAGMENT_SHADER, loadRes(L"light.frag", RT_RCDATA));
+		link();
+
+		uTiles = uniform<GLuint>("uTiles");
+	}
+
+	LightCullShader::LightCullShader() : Program() {
+		attach(GL_COMPUTE_SHADER, loadRes(L"light.comp", RT_RCDATA));
+		link();
+
+		uCount = uniform<GLuint>("uCount");
+	}
+
+	ParticleShader::ParticleShader() : Program() {
+		attach(GL_VERTEX_SHADER, loadRes(L"particle.vert", RT_RCDATA));
+		attach(GL_FRAGMENT_SHADER, loadRes(L"particle.frag", RT_RCDATA));
+		link();
+
+		uView = uniform<mat4>("uView");
+		uZoom = uniform<GLfloat>("uZoom");
+	}
+
+	ParticleStateShader::ParticleStateShader() : Program() {
+		attach(GL_VERTEX_SHADER, loadRes(L"particleState.vert", RT_RCDATA));
+		attach(GL_FRAGMENT_SHADER, loadRes(L"particle.frag", RT_RCDATA));
+		link();
+
+		uView = uniform<mat4>("uView");
+		uZoom = uniform<GLfloat>("uZoom");
+		uAlpha = uniform<GLfloat>("uAlpha");
+		uLod = uniform<GLfloat>("uLod");
+	}
+
+	ParticleComputeShader::ParticleComputeShader() : Program() {
+		attach(GL_COMPUTE_SHADER, loadRes(L"particle.comp", RT_RCDATA));
+		link();
+
+		uCapacity = uniform<GLuint>("uCapacity");
+		uCount = uniform<GLuint>("uCount");
+		uSpawn = uniform<GLint>("uSpawn");
+		uDelta = uniform<GLfloat>("uDelta");
+		uShift = uniform<vec2>("uShift");
 	}
 }
@@ -2,12 +2,112 @@
 
 #include "main.hpp"
 #include "argon.hpp"
+#include "glm/glm.hpp"
+
+#include <filesystem>
 
 using namespace Ar;
+using namespace glm;
 
 namespace He {
-	class StarshipShader : public Shader {
+	template<typename T> class Uniform {
+	public:
+		GLuint program = 0;
+		GLint location = -1;
+
+		void set(const T& value);
+	};
+
+	template<> void Uniform<GLint>::set(const GLint& value);
+
+	template<> void Uniform<GLuint>::set(const GLuint& value);
+
+	template<> void Uniform<GLfloat>::set(const GLfloat& value);
+
+	template<> void Uniform<vec2>::set(const vec2& value);
+
+	template<> void Uniform<mat4>::set(const mat4& value);
+
+	class Program : public Shader {
+	public:
+		static inline filesystem::path cache = "shadercache";
+
+		vector<pair<GLenum, string>> sources;
+
+		void attach(GLenum type, string source);
+
+		void link();
+
+		template<typename T> Uniform<T> uniform(const char* name) {
+			GLint location = glGetUniformLocation(id, name);
+
+			if (location == -1) {
+				cerr << "Unknown uniform " << name << " in program " << id << endl;
+			}
+
+			return { id, location };
+		}
+	};
+
+	class StarshipShader : public Program {
 	public:
+		Uniform<mat4> uView;
+
 		StarshipShader();
 	};
+
+	class SpriteShader : public Program {
+	public:
+		Uniform<mat4> uView;
+
+		SpriteShader();
+	};
+
+	class PostShader : public Program {
+	public:
+		Uniform<GLint> uTex;
+		Uniform<vec2> uScale;
+
+		PostShader();
+	};
+
+	class LightShader : public Program {
+	public:
+		Uniform<GLuint> uTiles;
+
+		LightShader();
+	};
+
+	class LightCullShader : public Program {
+	public:
+		Uniform<GLuint> uCount;
+
+		LightCullShader();
+	};
+
+	class ParticleShader : public Program {
+	public:
+		Uniform<mat4> uView;
+		Uniform<GLfloat> uZoom;
+
+		ParticleShader();
+	};
+
+	class ParticleStateShader : public Program {
+	public:
+		Uniform<mat4> uView;
+		Uniform<GLfloat> uZoom, uAlpha, uLod;
+
+		ParticleStateShader();
+	};
+
+	class ParticleComputeShader : public Program {
+	public:
+		Uniform<GLuint> uCapacity, uCount;
+		Uniform<GLint> uSpawn;
+		Uniform<GLfloat> uDelta;
+		Uniform<vec2> uShift;
+
+		ParticleComputeShader();
+	};
 }
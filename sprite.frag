@@ -0,0 +1,15 @@
+#version 460
+#extension GL_ARB_bindless_texture : require
+
+in flat uvec2 fTex;
+in vec2 fTexCoord;
+
+out vec4 oCol;
+
+void main() {
+	oCol = texture(sampler2D(fTex), fTexCoord);
+
+	if (oCol.a == 0) {
+		discard;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 460
+
+layout(location = 0) in vec2 vPos;
+layout(location = 1) in mat4 iMat;
+layout(location = 5) in uvec2 iTex;
+
+out flat uvec2 fTex;
+out vec2 fTexCoord;
+
+uniform mat4 uView;
+
+void main() {
+	gl_Position = uView * iMat * vec4(vPos, 0, 1);
+	fTexCoord = vPos;
+	fTex = iTex;
+}
\ No newline at end of file
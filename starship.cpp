@@ -6,269 +6,250 @@
 #include "tiles.hpp"
 
 namespace He {
-	Starship::Starship(const uint32_t width, const uint32_t height) : width(width), height(height), tiles(new Tile* [width * height]()), len(width* height * 6) {
-		glGenVertexArrays(1, &vao);
-
-		glBindVertexArray(vao);
-
-		glGenBuffers(1, &vPos);
-		glBindBuffer(GL_ARRAY_BUFFER, vPos);
-		glBufferData(GL_ARRAY_BUFFER, width * height * 8 * sizeof(GLushort), nullptr, GL_STATIC_DRAW);
+	Starship::Starship(const uint32_t width, const uint32_t height) : width(width), height(height), tiles(new Tile* [width * height]()), emitters(new EmitterState[width * height]()) {
+		allocate(width, height);
+		repaint();
+	}
 
-		GLushort* vBuf = (GLushort*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+	void Starship::allocate(uint32_t width, uint32_t height) {
+		delete[] handles;
+		delete[] slots;
+		handles = new GLuint64[width * height]();
+		slots = new uint32_t[width * height]();
+		dirty.clear();
+		stale = true;
+	}
 
-		uint32_t i = 0;
+	void Starship::resize(uint32_t width, uint32_t height) {
+		allocate(width, height);
 
-		for (GLushort x = 0; x < width; x++) {
-			for (GLushort y = 0; y < height; y++) {
-				vBuf[i++] = x;
-				vBuf[i++] = y;
+		Tile** nTiles = new Tile * [width * height]();
+		EmitterState* nEmitters = new EmitterState[width * height]();
+		uint32_t oldW = this->width;
+		uint32_t oldH = this->height;
+		uint32_t minW = (oldW < width ? oldW : width);
+		uint32_t minH = (oldH < height ? oldH : height);
 
-				vBuf[i++] = x;
-				vBuf[i++] = y + 1;
+		for (uint32_t x = 0; x < minW; x++) {
+			copy(tiles + x * oldH, tiles + x * oldH + minH, nTiles + x * height);
+			copy(emitters + x * oldH, emitters + x * oldH + minH, nEmitters + x * height);
 
-				vBuf[i++] = x + 1;
-				vBuf[i++] = y + 1;
+			for (uint32_t y = minH; y < oldH; y++) {
+				account(x, y, tiles[x * oldH + y], -1);
+			}
+		}
 
-				vBuf[i++] = x + 1;
-				vBuf[i++] = y;
+		for (uint32_t x = minW; x < oldW; x++) {
+			for (uint32_t y = 0; y < oldH; y++) {
+				account(x, y, tiles[x * oldH + y], -1);
 			}
 		}
 
-		glUnmapBuffer(GL_ARRAY_BUFFER);
-		glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, false, 0, 0);
-		glEnableVertexAttribArray(0);
+		this->width = width;
+		this->height = height;
+		delete[] tiles;
+		delete[] emitters;
+		tiles = nTiles;
+		emitters = nEmitters;
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		repaint();
+	}
 
-		glGenBuffers(1, &ebo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, len * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+	void Starship::control(GLFWwindow* win) {
+		turn = 0;
+		throttle = 0;
+		thrust = false;
 
-		GLuint* eBuf = (GLuint*)glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
+		if (glfwGetKey(win, GLFW_KEY_A) == GLFW_PRESS) {
+			turn += 1;
+		}
 
-		i = 0;
-		uint32_t j = 0;
+		if (glfwGetKey(win, GLFW_KEY_D) == GLFW_PRESS) {
+			turn -= 1;
+		}
 
-		for (GLuint x = 0; x < width; x++) {
-			for (GLuint y = 0; y < height; y++) {
-				eBuf[i++] = j + 0;
-				eBuf[i++] = j + 1;
+		if (glfwGetKey(win, GLFW_KEY_W) == GLFW_PRESS) {
+			throttle += 1;
+			thrust = true;
+		}
 
-				eBuf[i++] = j + 2;
-				eBuf[i++] = j + 2;
+		if (glfwGetKey(win, GLFW_KEY_S) == GLFW_PRESS) {
+			throttle -= 1;
+			thrust = true;
+		}
+	}
 
-				eBuf[i++] = j + 3;
-				eBuf[i++] = j + 0;
+	void Starship::tick(Universe* universe) {
+		lastRot = rot;
+		rot += turn * universe->delta * 90;
 
-				j += 4;
-			}
+		float acc = throttle * speed;
+
+		if (thrust) {
+			phys.wake();
 		}
 
-		glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		float rad90 = radians(rot + 90);
 
-		glBindVertexArray(0);
+		phys.vx() += cos(rad90) * acc * universe->delta;
+		phys.vy() += sin(rad90) * acc * universe->delta;
 
-		glGenBuffers(1, &uTex);
+		vec2 pos = universe->relative(phys);
+		mat4 mat = matrix(pos.x, pos.y, rot);
 
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, uTex);
-		GLuint size = width * height * sizeof(GLuint64);
-		glBufferStorage(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
-		textures = (GLuint64*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		for (uint32_t i : dynamic) {
+			tiles[i]->tick(universe, i / height, i % height, i, this, mat);
+		}
 	}
 
-	void Starship::resize(uint32_t width, uint32_t height) {
-		glBindVertexArray(vao);
-
-		glBindBuffer(GL_ARRAY_BUFFER, vPos);
-		glBufferData(GL_ARRAY_BUFFER, width * height * 8 * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+	mat4 Starship::matrix(float x, float y, float rot) {
+		mat4 mat = mat4(1);
 
-		GLuint* vBuf = (GLuint*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+		mat = translate(mat, vec3(x, y, 0));
 
-		uint32_t i = 0;
+		mat = rotate(mat, radians(rot), vec3(0, 0, 1));
 
-		for (uint32_t x = 0; x < width; x++) {
-			for (uint32_t y = 0; y < height; y++) {
-				vBuf[i++] = x;
-				vBuf[i++] = y;
+		vec2 com = center();
 
-				vBuf[i++] = x;
-				vBuf[i++] = y + 1;
+		mat = translate(mat, vec3(-com.x, -com.y, 0));
 
-				vBuf[i++] = x + 1;
-				vBuf[i++] = y + 1;
+		return mat;
+	}
 
-				vBuf[i++] = x + 1;
-				vBuf[i++] = y;
-			}
+	Bounds Starship::bounds(Universe* universe) {
+		vec2 pos = universe->relative(phys);
+		mat4 mat = matrix(pos.x, pos.y, rot);
+		vec4 corners[4] = { mat * vec4(0, 0, 0, 1), mat * vec4(width, 0, 0, 1), mat * vec4(0, height, 0, 1), mat * vec4(width, height, 0, 1) };
+		Bounds box = { corners[0].x, corners[0].y, corners[0].x, corners[0].y };
+
+		for (vec4 c : corners) {
+			box.minX = c.x < box.minX ? c.x : box.minX;
+			box.minY = c.y < box.minY ? c.y : box.minY;
+			box.maxX = c.x > box.maxX ? c.x : box.maxX;
+			box.maxY = c.y > box.maxY ? c.y : box.maxY;
 		}
 
-		glUnmapBuffer(GL_ARRAY_BUFFER);
-		glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, false, 0, 0);
-		glEnableVertexAttribArray(0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, len * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
-
-		GLuint* eBuf = (GLuint*)glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
+		return box;
+	}
 
-		i = 0;
-		uint32_t j = 0;
+	mat4 Starship::transform(Universe* universe) {
+		vec2 pos = universe->interpolated(phys);
 
-		for (uint32_t x = 0; x < width; x++) {
-			for (uint32_t y = 0; y < height; y++) {
-				eBuf[i++] = j + 0;
-				eBuf[i++] = j + 1;
+		return matrix(pos.x, pos.y, mix(lastRot, rot, universe->alpha));
+	}
 
-				eBuf[i++] = j + 2;
-				eBuf[i++] = j + 2;
+	void Starship::frame(Universe* universe, mat4 mat) {
+		vec2 d = universe->cursor - vec2(mat[3].x, mat[3].y);
 
-				eBuf[i++] = j + 3;
-				eBuf[i++] = j + 0;
+		aim = vec2(mat[0].x * d.x + mat[0].y * d.y, mat[1].x * d.x + mat[1].y * d.y);
 
-				j += 4;
-			}
+		for (uint32_t i : dynamic) {
+			tiles[i]->frame(universe, i / height, i % height, i, this, mat);
 		}
+	}
 
-		glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-		glBindVertexArray(0);
-
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, uTex);
-		glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	Tile* Starship::get(int x, int y) {
+		return tiles[x * height + y];
+	}
 
-		glDeleteBuffers(1, &uTex);
-		glGenBuffers(1, &uTex);
+	void Starship::set(int x, int y, Tile* tile) {
+		uint32_t i = x * height + y;
+		Tile*& slot = tiles[i];
 
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, uTex);
-		GLuint size = width * height * sizeof(GLuint64);
-		glBufferStorage(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
-		textures = (GLuint64*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		account(x, y, slot, -1);
+		account(x, y, tile, 1);
 
-		Tile** nTiles = new Tile * [width * height]();
-		uint32_t oldW = this->width;
-		uint32_t oldH = this->height;
-		uint32_t minW = (oldW < width ? oldW : width);
-		uint32_t minH = (oldH < height ? oldH : height);
+		if (slot != nullptr && slot->dynamic()) {
+			uint32_t last = dynamic.back();
 
-		for (uint32_t y = 0, i = 0, j = 0; y < minH; y++, i += width, j += oldW) {
-			for (uint32_t x = 0; x < minW; x++) {
-				nTiles[i + x] = tiles[j + x];
-			}
+			dynamic[slots[i]] = last;
+			slots[last] = slots[i];
+			dynamic.pop_back();
 		}
 
-		for (uint32_t i = 0, x = 0; x < width; x++) {
-			for (uint32_t y = 0; y < height; y++, i++) {
-				cout << x << " " << y << ": " << nTiles[i] << endl;
-			}
+		if (tile != nullptr && tile->dynamic()) {
+			slots[i] = dynamic.size();
+			dynamic.push_back(i);
 		}
 
-		this->width = width;
-		this->height = height;
-		delete[] tiles;
-		tiles = nTiles;
+		slot = tile;
+		emitters[i] = EmitterState();
+
+		paint(i, tile != nullptr ? tile->texture(this, i) : 0);
 	}
 
-	void Starship::render(Universe* universe) {
-		if (glfwGetKey(universe->frame->handle, GLFW_KEY_A) == GLFW_PRESS) {
-			rot += universe->delta * 90;
+	void Starship::account(uint32_t x, uint32_t y, Tile* tile, float sign) {
+		if (tile == nullptr) {
+			return;
 		}
 
-		if (glfwGetKey(universe->frame->handle, GLFW_KEY_D) == GLFW_PRESS) {
-			rot -= universe->delta * 90;
-		}
+		double m = sign * tile->mass, cx = x + 0.5, cy = y + 0.5;
 
-		float acc = 0;
+		mass += m;
+		mx += m * cx;
+		my += m * cy;
+		mr += m * (cx * cx + cy * cy + 1.0 / 6);
 
-		if (glfwGetKey(universe->frame->handle, GLFW_KEY_W) == GLFW_PRESS) {
-			acc += speed;
+		if (mass < 1e-9) {
+			mass = mx = my = mr = 0;
 		}
 
-		if (glfwGetKey(universe->frame->handle, GLFW_KEY_S) == GLFW_PRESS) {
-			acc -= speed;
+		if (phys.valid()) {
+			phys.mass() = (float)mass;
 		}
+	}
 
-		float rad = radians(rot), rad90 = radians(rot + 90);
-
-		phys.vx += cos(rad90) * acc * universe->delta;
-		phys.vy += sin(rad90) * acc * universe->delta;
-
-		const float max = 500;
-
-		if (phys.x > max) {
-			phys.x = max;
-			phys.vx = 0;
+	void Starship::paint(uint32_t i, GLuint64 handle) {
+		if (handles[i] == handle) {
+			return;
 		}
 
-		if (phys.x < -max) {
-			phys.x = -max;
-			phys.vx = 0;
-		}
+		handles[i] = handle;
 
-		if (phys.y > max) {
-			phys.y = max;
-			phys.vy = 0;
+		if (stale) {
+			return;
 		}
 
-		if (phys.y < -max) {
-			phys.y = -max;
-			phys.vy = 0;
+		if (dirty.size() >= width * height) {
+			dirty.clear();
+			stale = true;
+			return;
 		}
 
-		mat4 mat = mat4(1);
-
-		mat = translate(mat, vec3(phys.x, phys.y, 0));
-
-		mat = rotate(mat, rad, vec3(0, 0, 1));
-
-		mat = translate(mat, vec3(-(float)width / 2, -(float)height / 2, 0));
-
-		uint32_t i = 0;
+		dirty.push_back(i);
+	}
 
-		for (uint32_t x = 0; x < width; x++) {
-			for (uint32_t y = 0; y < height; y++) {
-				Tile* t = tiles[i];
+	void Starship::repaint() {
+		dynamic.clear();
 
-				if (t != nullptr) {
-					t->frame(universe, x, y, i, this, mat);
-				} else {
-					textures[i] = 0;
-				}
+		for (uint32_t i = 0; i < width * height; i++) {
+			Tile* t = tiles[i];
 
-				i++;
+			if (t != nullptr && t->dynamic()) {
+				slots[i] = dynamic.size();
+				dynamic.push_back(i);
 			}
-		}
-
-		glBindVertexArray(vao);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glUseProgram(universe->shipShader->id);
 
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, uTex);
-
-		glUniformMatrix4fv(glGetUniformLocation(universe->shipShader->id, "uView"), 1, GL_FALSE, value_ptr(universe->viewMat));
-		glUniformMatrix4fv(glGetUniformLocation(universe->shipShader->id, "uMat"), 1, GL_FALSE, value_ptr(mat));
+			handles[i] = t != nullptr ? t->texture(this, i) : 0;
+		}
 
-		glDrawElements(GL_TRIANGLES, len, GL_UNSIGNED_INT, 0);
+		dirty.clear();
+		stale = true;
+	}
 
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+	vec2 Starship::center() {
+		if (mass == 0) {
+			return vec2((float)width / 2, (float)height / 2);
+		}
 
-		glUseProgram(0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		return vec2((float)(mx / mass), (float)(my / mass));
 	}
 
-	Tile* Starship::get(int x, int y) {
-		return tiles[x * height + y];
-	}
+	float Starship::inertia() {
+		if (mass == 0) {
+			return 0;
+		}
 
-	void Starship::set(int x, int y, Tile* tile) {
-		tiles[x * height + y] = tile;
+		return (float)(mr - (mx * mx + my * my) / mass);
 	}
 }
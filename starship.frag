@@ -11,6 +11,10 @@ layout(std430, binding = 0) buffer Textures {
 };
 
 void main() {
+	if (uTex[fTex] == uvec2(0)) {
+		discard;
+	}
+
 	oCol = texture(sampler2D(uTex[fTex]), fTexCoord);
 	//gl_FragDepth = 1;
 
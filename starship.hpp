@@ -2,26 +2,60 @@
 
 #include "main.hpp"
 #include "physics.hpp"
+#include "broadphase.hpp"
+#include "sfx.hpp"
 #include "argon.hpp"
+#include "glm/glm.hpp"
+
+using namespace glm;
 
 namespace He {
 	struct Starship {
 	public:
-		uint32_t width, height, len;
-		PhysicsObject phys = PhysicsObject(5);
-		float rot = 0, speed = 5;
-		GLuint vao, vPos, ebo, uTex;
-		GLuint64* textures;
+		uint32_t width, height;
+		PhysicsObject phys;
+		float rot = 0, lastRot = 0, speed = 5, turn = 0, throttle = 0;
+		double mass = 0, mx = 0, my = 0, mr = 0;
+		bool thrust = false;
+		vec2 aim = vec2(0);
+		bool stale = true;
+		uint32_t base = 0, reserved = 0;
+		GLuint64* handles = nullptr;
+		uint32_t* slots = nullptr;
 		Tile** tiles;
+		EmitterState* emitters;
+		vector<uint32_t> dynamic, dirty;
 
 		Starship(const uint32_t width, const uint32_t height);
 
+		void allocate(uint32_t width, uint32_t height);
+
 		void resize(uint32_t width, uint32_t height);
 
-		void render(Universe* universe);
+		void control(GLFWwindow* win);
+
+		void tick(Universe* universe);
+
+		mat4 matrix(float x, float y, float rot);
+
+		Bounds bounds(Universe* universe);
+
+		mat4 transform(Universe* universe);
+
+		void frame(Universe* universe, mat4 mat);
 
 		Tile* get(int x, int y);
 
 		void set(int x, int y, Tile* comp);
+
+		void account(uint32_t x, uint32_t y, Tile* tile, float sign);
+
+		void paint(uint32_t i, GLuint64 handle);
+
+		void repaint();
+
+		vec2 center();
+
+		float inertia();
 	};
 }
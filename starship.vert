@@ -1,15 +1,27 @@
 #version 460
 
-layout(location = 0) in vec2 vPos;
+struct ShipDraw {
+	mat4 mat;
+	uint base, height;
+};
+
+layout(std430, binding = 1) readonly buffer Draws {
+	ShipDraw uDraws[];
+};
 
 out flat uint fTex;
 out vec2 fTexCoord;
 
-uniform mat4 uMat;
-uniform mat4 uViewMat;
+uniform mat4 uView;
+
+const vec2 corners[4] = vec2[](vec2(0, 0), vec2(0, 1), vec2(1, 1), vec2(1, 0));
 
 void main() {
-	gl_Position = uViewMat * uMat * vec4(vPos, 0, 1);
-	fTexCoord = vPos;
-	fTex = gl_VertexID >> 2;
+	ShipDraw d = uDraws[gl_BaseInstance];
+	uint tile = gl_VertexID >> 2;
+	vec2 corner = corners[gl_VertexID & 3];
+
+	gl_Position = uView * d.mat * vec4(vec2(tile / d.height, tile % d.height) + corner, 0, 1);
+	fTexCoord = corner;
+	fTex = d.base + tile;
 }
\ No newline at end of file
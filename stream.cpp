@@ -0,0 +1,79 @@
+#pragma once
+
+#include "stream.hpp"
+
+namespace He {
+	StreamBuffer::StreamBuffer(GLsizeiptr size) {
+		allocate(size);
+	}
+
+	void* StreamBuffer::alloc(GLsizeiptr bytes, GLsizeiptr align, GLintptr& at) {
+		GLsizeiptr start = (offset + align - 1) / align * align;
+
+		if (start + bytes > size) {
+			GLsizeiptr grown = size * 2;
+
+			while (grown < bytes) {
+				grown *= 2;
+			}
+
+			for (uint32_t i = 0; i < regions; i++) {
+				wait(i);
+			}
+
+			allocate(grown);
+			start = 0;
+		}
+
+		offset = start + bytes;
+		at = region * size + start;
+
+		return data + at;
+	}
+
+	void StreamBuffer::shrink(GLintptr at, GLsizeiptr bytes) {
+		offset = at - region * size + bytes;
+	}
+
+	void StreamBuffer::advance() {
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		region = (region + 1) % regions;
+		offset = 0;
+
+		wait(region);
+	}
+
+	void StreamBuffer::allocate(GLsizeiptr size) {
+		if (id != 0) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+			glDeleteBuffers(1, &id);
+		}
+
+		this->size = size;
+		offset = 0;
+
+		glGenBuffers(1, &id);
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size * regions, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+		data = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size * regions, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void StreamBuffer::wait(uint32_t region) {
+		GLsync& fence = fences[region];
+
+		if (fence == nullptr) {
+			return;
+		}
+
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+}
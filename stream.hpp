@@ -0,0 +1,32 @@
+#pragma once
+
+#include "main.hpp"
+#include "argon.hpp"
+
+using namespace Ar;
+
+namespace He {
+	class StreamBuffer {
+	public:
+		static constexpr uint32_t regions = 3;
+
+		GLuint id = 0;
+		GLsizeiptr size = 0, offset = 0;
+		uint32_t region = 0;
+		uint8_t* data = nullptr;
+		GLsync fences[regions] = {};
+
+		StreamBuffer(GLsizeiptr size);
+
+		void* alloc(GLsizeiptr bytes, GLsizeiptr align, GLintptr& at);
+
+		void shrink(GLintptr at, GLsizeiptr bytes);
+
+		void advance();
+
+	private:
+		void allocate(GLsizeiptr size);
+
+		void wait(uint32_t region);
+	};
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "target.hpp"
+
+namespace He {
+	void RenderTarget::resize(GLsizei width, GLsizei height) {
+		GLsizei w = (GLsizei)ceil(width * supersample), h = (GLsizei)ceil(height * supersample);
+
+		this->width = width;
+		this->height = height;
+
+		if (w == texWidth && h == texHeight) {
+			return;
+		}
+
+		texWidth = w;
+		texHeight = h;
+
+		if (fbo == 0) {
+			glGenFramebuffers(1, &fbo);
+			glGenTextures(1, &tex);
+			glGenRenderbuffers(1, &depth);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, w, h);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			cerr << "Framebuffer incomplete, status: " << status << endl;
+			exit(-1);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	ivec2 RenderTarget::size() {
+		float s = scale < supersample ? scale : supersample;
+		GLsizei w = (GLsizei)round(width * s), h = (GLsizei)round(height * s);
+
+		return ivec2(w < 1 ? 1 : w, h < 1 ? 1 : h);
+	}
+
+	void RenderTarget::bind() {
+		ivec2 s = size();
+
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glViewport(0, 0, s.x, s.y);
+	}
+
+	void ResolutionController::begin() {
+		if (!enabled) {
+			return;
+		}
+
+		if (ids[0] == 0) {
+			glGenQueries(queries, ids);
+		}
+
+		GLuint id = ids[frame % queries];
+
+		if (frame >= queries) {
+			GLint ready = 0;
+			glGetQueryObjectiv(id, GL_QUERY_RESULT_AVAILABLE, &ready);
+
+			if (ready) {
+				GLuint64 ns = 0;
+				glGetQueryObjectui64v(id, GL_QUERY_RESULT, &ns);
+
+				double ms = ns / 1e6;
+				time = time == 0 ? ms : time * 0.9 + ms * 0.1;
+			}
+		}
+
+		glBeginQuery(GL_TIME_ELAPSED, id);
+	}
+
+	void ResolutionController::end() {
+		if (!enabled) {
+			return;
+		}
+
+		glEndQuery(GL_TIME_ELAPSED);
+		frame++;
+	}
+
+	float ResolutionController::adjust(float scale, float maxScale) {
+		if (!enabled) {
+			return maxScale;
+		}
+
+		if (scale > maxScale) {
+			return maxScale;
+		}
+
+		if (time == 0) {
+			return scale;
+		}
+
+		if (time > budget && scale - step >= minScale) {
+			time *= (scale - step) * (scale - step) / (scale * scale);
+			return scale - step;
+		}
+
+		if (time < budget * 0.7 && scale + step <= maxScale) {
+			time *= (scale + step) * (scale + step) / (scale * scale);
+			return scale + step;
+		}
+
+		return scale;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "main.hpp"
+#include "argon.hpp"
+#include "glm/glm.hpp"
+
+using namespace Ar;
+using namespace glm;
+
+namespace He {
+	class RenderTarget {
+	public:
+		GLuint fbo = 0, tex = 0, depth = 0;
+		GLsizei width = 0, height = 0, texWidth = 0, texHeight = 0;
+		float scale = 2, supersample = 2;
+
+		void resize(GLsizei width, GLsizei height);
+
+		ivec2 size();
+
+		void bind();
+	};
+
+	class ResolutionController {
+	public:
+		static constexpr uint32_t queries = 4;
+
+		GLuint ids[queries] = {};
+		uint32_t frame = 0;
+		double budget = 12, time = 0;
+		float minScale = 0.5, step = 0.125;
+		bool enabled = false;
+
+		void begin();
+
+		void end();
+
+		float adjust(float scale, float maxScale);
+	};
+}
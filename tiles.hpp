@@ -2,6 +2,7 @@
 
 #include "main.hpp"
 #include "argon.hpp"
+#include "sfx.hpp"
 #include "glm/glm.hpp"
 
 using namespace glm;
@@ -9,7 +10,15 @@ using namespace glm;
 namespace He {
 	class Tile {
 	public:
-		virtual void frame(Universe* universe, uint32_t x, uint32_t y, uint32_t i, Starship* ship, mat4 mat) = 0;
+		float mass = 1;
+
+		virtual bool dynamic();
+
+		virtual GLuint64 texture(Starship* ship, uint32_t i) = 0;
+
+		virtual void tick(Universe* universe, uint32_t x, uint32_t y, uint32_t i, Starship* ship, mat4 mat);
+
+		virtual void frame(Universe* universe, uint32_t x, uint32_t y, uint32_t i, Starship* ship, mat4 mat);
 	};
 
 	class BasicTile : public Tile {
@@ -17,18 +26,18 @@ namespace He {
 		GLuint tex;
 		GLuint64 bindless = 0;
 
-		BasicTile();
+		BasicTile(Universe* universe);
 
 		virtual void upload(const void* data, GLsizei width, GLsizei height, GLenum format, GLenum type);
 
 		virtual void upload(string img);
 
-		void frame(Universe* universe, uint32_t x, uint32_t y, uint32_t i, Starship* ship, mat4 mat);
+		GLuint64 texture(Starship* ship, uint32_t i);
 	};
 
 	class PlatingTile : public BasicTile {
 	public:
-		PlatingTile();
+		PlatingTile(Universe* universe);
 	};
 
 	class MultiTile : public Tile {
@@ -36,29 +45,35 @@ namespace He {
 		GLuint* tex;
 		GLuint64* bindless;
 
-		MultiTile(int i);
+		MultiTile(Universe* universe, int i);
 
 		virtual void upload(const void* data, GLsizei width, GLsizei height, GLenum format, GLenum type, int i = 0);
 
 		virtual void upload(string img, int i = 0);
 
-		void frame(Universe* universe, uint32_t x, uint32_t y, uint32_t i, Starship* ship, mat4 mat);
+		GLuint64 texture(Starship* ship, uint32_t i);
 	};
 
 	class EngineTile : public MultiTile {
 	public:
-		EngineTile();
+		EmitterDesc exhaust;
+
+		EngineTile(Universe* universe);
+
+		bool dynamic();
+
+		GLuint64 texture(Starship* ship, uint32_t i);
+
+		void tick(Universe* universe, uint32_t x, uint32_t y, uint32_t i, Starship* ship, mat4 mat);
 
 		void frame(Universe* universe, uint32_t x, uint32_t y, uint32_t i, Starship* ship, mat4 mat);
 	};
 
 	class TurretTile : public MultiTile {
 	public:
-		GLuint vao, vPos, ebo, uTex;
-
-		TurretTile();
+		TurretTile(Universe* universe);
 
-		void upload(const void* data, GLsizei width, GLsizei height, GLenum format, GLenum type, int i = 0);
+		bool dynamic();
 
 		void frame(Universe* universe, uint32_t x, uint32_t y, uint32_t i, Starship* ship, mat4 mat);
 	};
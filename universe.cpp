@@ -5,54 +5,36 @@
 #include "shaders.hpp"
 #include "sfx.hpp"
 #include "physics.hpp"
+#include "starship.hpp"
+#include "fleet.hpp"
 
 #define NANOVG_GL3_IMPLEMENTATION
 #include "nanovg_gl.h"
 
+#include <chrono>
+
 namespace He {
+	Universe::Universe() : frame(nullptr), vg(nullptr), headless(true), postShader(nullptr), shipShader(nullptr), fleet(nullptr), stream(nullptr) {}
+
 	Universe::Universe(GLFrame* frame) : frame(frame) {
 		frame->children.addFirst(this);
 
 		glfwMakeContextCurrent(frame->handle);
 		vg = nvgCreateGL3(NVG_ANTIALIAS | NVG_STENCIL_STROKES | NVG_DEBUG);
 
-		glGenFramebuffers(1, &fbo);
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-		glGenTextures(1, &tex);
-		glBindTexture(GL_TEXTURE_2D, tex);
-
 		int width, height;
 		glfwGetFramebufferSize(frame->handle, &width, &height);
 
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width * aliasW, height * aliasH, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
-
-		GLuint rbo;
-		glGenRenderbuffers(1, &rbo);
-		glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width * aliasW, height * aliasH);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbo);
-
-		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-		if (status != GL_FRAMEBUFFER_COMPLETE) {
-			cerr << "Framebuffer incomplete, status: " << status << endl;
-			exit(-1);
-		}
+		target.resize(width, height);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		postShader = new Shader();
-		postShader->attach(GL_VERTEX_SHADER, loadRes(L"post.vert", RT_RCDATA));
-		postShader->attach(GL_FRAGMENT_SHADER, loadRes(L"post.frag", RT_RCDATA));
-		postShader->link();
+		postShader = new PostShader();
 
 		shipShader = new StarshipShader();
 
+		stream = new StreamBuffer(1 << 22);
+
+		fleet = new FleetRenderer();
+
 		glGenVertexArrays(1, &vao);
 		glBindVertexArray(vao);
 
@@ -83,17 +65,86 @@ namespace He {
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 		glBindVertexArray(0);
+	}
 
-		glGenBuffers(1, &lightBuf);
-		glGenBuffers(1, &lineBuf);
+	void Universe::useCompute(uint32_t capacity) {
+		gpuParticles.init(capacity);
+		compute = true;
+	}
+
+	void Universe::emit(const Particle& p) {
+		if (compute) {
+			gpuParticles.add(p);
+		} else {
+			particles.add(p);
+		}
+	}
+
+	void Universe::spawn() {
+		uint32_t total = 0;
+
+		for (Emission& e : emissions) {
+			if (e.state->random.state == 0) {
+				e.state->random = Random(random.next());
+				e.state->accumulator = e.state->random.uniform(0, 1);
+			}
+
+			e.state->accumulator += e.desc->rate * delta;
+			total += (uint32_t)e.state->accumulator;
+		}
+
+		if (compute) {
+			gpuParticles.spawns.reserve(gpuParticles.spawns.size() + total);
+		} else {
+			particles.reserve(particles.count() + total);
+		}
+
+		for (Emission& e : emissions) {
+			const EmitterDesc& desc = *e.desc;
+			Random& rand = e.state->random;
+
+			for (; e.state->accumulator >= 1; e.state->accumulator--) {
+				vec4 col = mix(desc.from, desc.to, rand.uniform(0, 1));
+				col.w = rand.uniform(desc.alpha);
+
+				emit(Particle(
+					e.pos + vec2(rand.uniform(desc.jitter), rand.uniform(desc.jitter)),
+					e.vel * desc.inherit,
+					col,
+					rand.uniform(desc.size),
+					rand.uniform(desc.life),
+					desc.behaviour,
+					(uint32_t)(rand.next() >> 32)
+				));
+			}
+		}
+
+		emissions.clear();
 	}
 
 	void Universe::startFrame() {
 		double now = glfwGetTime();
-		delta = now - last;
+		frameDelta = now - last;
 		last = now;
 
+		accumulator += frameDelta;
+
+		for (uint32_t steps = 0; accumulator >= delta; steps++) {
+			if (steps == maxSteps) {
+				accumulator = 0;
+				break;
+			}
+
+			tick();
+			accumulator -= delta;
+		}
+
+		alpha = accumulator / delta;
+
+		camera = focus.valid() ? interpolated(focus) : vec2(0);
+
 		lights.clear();
+		sprites.clear();
 		//lineLights.clear();
 
 		int width, height;
@@ -102,6 +153,13 @@ namespace He {
 		aRatio = (float)width / height;
 
 		viewMat = scale(mat4(1), aRatio > 1 ? vec3(zoom, aRatio * zoom, zoom) : vec3(aRatio * zoom, zoom, zoom));
+		viewMat = translate(viewMat, vec3(-camera.x, -camera.y, 0));
+
+		double cx, cy;
+		glfwGetCursorPos(frame->handle, &cx, &cy);
+
+		cursor = camera + vec2((float)(cx / width * 2 - 1) / viewMat[0][0], (float)(1 - cy / height * 2) / viewMat[1][1]);
+		firing = glfwGetMouseButton(frame->handle, GLFW_MOUSE_BUTTON_1) == GLFW_PRESS;
 
 		glEnable(GL_PROGRAM_POINT_SIZE);
 
@@ -112,140 +170,317 @@ namespace He {
 		glClearColor(0.05, 0.05, 0.05, 1);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-		glBindTexture(GL_TEXTURE_2D, tex);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width * aliasW, height * aliasH, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		target.scale = resolution.adjust(target.scale, target.supersample);
+		target.resize(width, height);
+		target.bind();
 
-		glViewport(0, 0, width * aliasW, height * aliasH);
+		resolution.begin();
 
 		glClearColor(0, 0, 0, 1);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
 
-		//for (OrbitalMass* mass : masses) {
-		//	for (OrbitalMass* other : masses) {
-		//		if (mass != other) {
-		//			mass->update(other, this);
-		//		}
-		//	}
-		//}
+	template<typename F> static void timed(double& total, F fn) {
+		auto start = chrono::steady_clock::now();
 
-		for (PhysicsObject* phys : objects) {
-			phys->frame(this);
-		}
+		fn();
+
+		total += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
 	}
 
-	void Universe::postFrame() {
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	void Universe::tick() {
+		timed(timings.ships, [this] {
+			for (Starship* ship : ships) {
+				ship->tick(this);
+			}
+			});
 
-		glBindVertexArray(vao);
-		glUseProgram(postShader->id);
+		objects.snapshot(0, objects.awake);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, tex);
+		step(delta);
 
-		glUniform1i(glGetUniformLocation(postShader->id, "uTex"), 0);
+		if (sleeping) {
+			timed(timings.sleep, [this] {
+				probe();
+				objects.settle(delta, sleepVelocity, sleepAcceleration, sleepTime);
+				});
+		}
 
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		rebase();
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+		timed(timings.broadphase, [this] {
+			broadphase.clear();
 
-		glUseProgram(0);
-		glBindVertexArray(0);
+			for (uint32_t i = 0; i < ships.size(); i++) {
+				broadphase.insert(i, ships[i]->bounds(this));
+			}
 
-		int width, height;
-		glfwGetFramebufferSize(frame->handle, &width, &height);
-		glViewport(0, 0, width, height);
+			broadphase.build();
+			});
 
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-		glBlendEquation(GL_FUNC_ADD);
+		if (sleeping) {
+			timed(timings.sleep, [this] {
+				islands();
+				});
+		}
 
-		GLuint len = 0;
+		timed(timings.particles, [this] {
+			spawn();
 
-		for (auto node = particles.first; node != nullptr; node = node->next) {
-			if (node->t.frame(this)) {
-				len++;
+			if (compute) {
+				gpuParticles.update(delta, stream);
 			} else {
-				node->unlink();
+				particles.update(delta, jobs);
 			}
+			});
+	}
+
+	void Universe::step(float dt) {
+		switch (integrator) {
+		case Integrator::Euler:
+		{
+			accelerate();
+			drift(dt);
+			kick(dt);
+			break;
+		}
+		case Integrator::SemiImplicit:
+		{
+			accelerate();
+			kick(dt);
+			drift(dt);
+			break;
 		}
+		case Integrator::Leapfrog:
+		case Integrator::Adaptive:
+		{
+			if (!objects.accelerated) {
+				accelerate();
+			}
 
-		static GLuint vao = 0, uPos, uCol, uSize;
-		static Shader shader;
+			uint32_t n = integrator == Integrator::Adaptive ? objects.substeps(dt, eta, length, maxSubsteps) : 1;
+			float h = dt / n;
 
-		if (vao == 0) {
-			glGenVertexArrays(1, &vao);
+			for (uint32_t i = 0; i < n; i++) {
+				kick(h / 2);
+				drift(h);
+				accelerate();
+				kick(h / 2);
+			}
 
-			glBindVertexArray(vao);
+			break;
+		}
+		};
+	}
 
-			glGenBuffers(1, &uPos);
-			glBindBuffer(GL_ARRAY_BUFFER, uPos);
-			glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, 0);
-			glEnableVertexAttribArray(0);
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
+	void Universe::accelerate() {
+		timed(timings.gravity, [this] {
+			gravity.build(&objects, originX, originY);
 
-			glGenBuffers(1, &uCol);
-			glBindBuffer(GL_ARRAY_BUFFER, uCol);
-			glVertexAttribPointer(1, 4, GL_FLOAT, false, 0, 0);
-			glEnableVertexAttribArray(1);
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			jobs.parallelFor(0, objects.awake, 1024, [this](uint32_t begin, uint32_t end) {
+				gravity.apply(begin, end);
+				});
 
-			glGenBuffers(1, &uSize);
-			glBindBuffer(GL_ARRAY_BUFFER, uSize);
-			glVertexAttribPointer(2, 1, GL_FLOAT, false, 0, 0);
-			glEnableVertexAttribArray(2);
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			objects.accelerated = true;
+			});
+	}
 
-			glBindVertexArray(0);
+	void Universe::kick(float dt) {
+		timed(timings.integrate, [this, dt] {
+			jobs.parallelFor(0, objects.awake, 16384, [this, dt](uint32_t begin, uint32_t end) {
+				objects.kick(begin, end, dt);
+				});
+			});
+	}
 
-			shader.attach(GL_VERTEX_SHADER, loadRes(L"particle.vert", RT_RCDATA));
-			shader.attach(GL_FRAGMENT_SHADER, loadRes(L"particle.frag", RT_RCDATA));
-			shader.link();
+	void Universe::drift(float dt) {
+		timed(timings.integrate, [this, dt] {
+			jobs.parallelFor(0, objects.awake, 16384, [this, dt](uint32_t begin, uint32_t end) {
+				objects.drift(begin, end, dt);
+				});
+			});
+	}
+
+	void Universe::rebase() {
+		jobs.parallelFor(0, objects.awake, 16384, [this](uint32_t begin, uint32_t end) {
+			objects.rebase(begin, end);
+			});
+
+		if (!focus.valid() || (focus.sx() == originX && focus.sy() == originY)) {
+			return;
 		}
 
-		vec2* points = new vec2[len];
-		vec4* colors = new vec4[len];
-		GLfloat* sizes = new GLfloat[len];
+		vec2 shift = vec2((float)(focus.sx() - originX), (float)(focus.sy() - originY)) * PhysicsWorld::sectorSize;
 
-		uint i = 0;
-		for (Particle p : particles) {
-			points[i] = p.pos;
-			colors[i] = p.col;
-			sizes[i] = p.size;
-			i++;
+		if (compute) {
+			gpuParticles.shift(-shift);
+		} else {
+			particles.shift(-shift);
 		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, uPos);
-		glBufferData(GL_ARRAY_BUFFER, len * sizeof(vec2), points, GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		for (Emission& e : emissions) {
+			e.pos -= shift;
+		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, uCol);
-		glBufferData(GL_ARRAY_BUFFER, len * sizeof(vec4), colors, GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		originX = focus.sx();
+		originY = focus.sy();
+	}
 
-		glBindBuffer(GL_ARRAY_BUFFER, uSize);
-		glBufferData(GL_ARRAY_BUFFER, len * sizeof(GLfloat), sizes, GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	void Universe::probe() {
+		uint32_t sleepers = objects.size() - objects.awake;
 
-		delete[] points;
-		delete[] colors;
-		delete[] sizes;
+		if (sleepers == 0 || gravity.x.size() != objects.size()) {
+			return;
+		}
+
+		if (sleepCursor >= sleepers) {
+			sleepCursor = 0;
+		}
+
+		uint32_t count = sleepers / 64 + 1;
+		uint32_t begin = objects.awake + sleepCursor;
+		uint32_t end = begin + count < objects.size() ? begin + count : objects.size();
+
+		sleepCursor += count;
+
+		gravity.apply(begin, end);
+
+		vector<uint32_t> woken;
+
+		for (uint32_t i = begin; i < end; i++) {
+			if (objects.ax[i] * objects.ax[i] + objects.ay[i] * objects.ay[i] >= sleepAcceleration * sleepAcceleration) {
+				woken.push_back(objects.owners[i]);
+			}
+		}
+
+		for (uint32_t id : woken) {
+			objects.wake(objects.slots[id]);
+		}
+	}
+
+	void Universe::islands() {
+		vector<uint32_t> parent(ships.size());
+
+		for (uint32_t i = 0; i < ships.size(); i++) {
+			parent[i] = i;
+		}
+
+		auto find = [&parent](uint32_t i) {
+			while (parent[i] != i) {
+				i = parent[i] = parent[parent[i]];
+			}
+
+			return i;
+		};
+
+		for (auto& pair : broadphase.pairs) {
+			parent[find(pair.first)] = find(pair.second);
+		}
+
+		vector<bool> active(ships.size());
+
+		for (uint32_t i = 0; i < ships.size(); i++) {
+			if (!ships[i]->phys.asleep()) {
+				active[find(i)] = true;
+			}
+		}
+
+		for (uint32_t i = 0; i < ships.size(); i++) {
+			if (active[find(i)]) {
+				ships[i]->phys.wake();
+			}
+		}
+	}
+
+	vec2 Universe::relative(PhysicsObject obj) {
+		return vec2((float)(obj.sx() - originX) * PhysicsWorld::sectorSize + obj.x(), (float)(obj.sy() - originY) * PhysicsWorld::sectorSize + obj.y());
+	}
+
+	vec2 Universe::interpolated(PhysicsObject obj) {
+		vec2 sector = vec2((float)(obj.sx() - originX), (float)(obj.sy() - originY)) * PhysicsWorld::sectorSize;
+
+		return sector + mix(vec2(obj.px(), obj.py()), vec2(obj.x(), obj.y()), alpha);
+	}
+
+	void Universe::postFrame() {
+		int width, height;
+		glfwGetFramebufferSize(frame->handle, &width, &height);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, width, height);
+
+		ivec2 size = target.size();
 
 		glBindVertexArray(vao);
-		glUseProgram(shader.id);
+		glUseProgram(postShader->id);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, target.tex);
 
-		glUniformMatrix4fv(glGetUniformLocation(shader.id, "uView"), 1, false, (GLfloat*)value_ptr(viewMat));
-		glUniform1f(glGetUniformLocation(shader.id, "uZoom"), zoom);
+		postShader->uTex.set(0);
+		postShader->uScale.set(vec2((float)size.x / target.width, (float)size.y / target.height));
+
+		glDrawArrays(GL_TRIANGLES, 0, 6);
 
-		glDrawArrays(GL_POINTS, 0, len);
+		glBindTexture(GL_TEXTURE_2D, 0);
 
 		glUseProgram(0);
 		glBindVertexArray(0);
 
-		for (Light light : lights) {
-			light.render(this);
+		resolution.end();
+
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+		glBlendEquation(GL_FUNC_ADD);
+
+		if (compute) {
+			gpuParticles.render(viewMat, zoom, alpha, particleLod);
+		} else {
+			GLuint len = particles.count();
+
+			static GLuint vao = 0;
+			static ParticleShader* shader = nullptr;
+
+			if (vao == 0) {
+				glGenVertexArrays(1, &vao);
+
+				glBindVertexArray(vao);
+
+				glVertexAttribFormat(0, 2, GL_FLOAT, false, offsetof(ParticleVertex, pos));
+				glVertexAttribFormat(1, 4, GL_FLOAT, false, offsetof(ParticleVertex, col));
+				glVertexAttribFormat(2, 1, GL_FLOAT, false, offsetof(ParticleVertex, size));
+
+				for (GLuint i = 0; i < 3; i++) {
+					glVertexAttribBinding(i, 0);
+					glEnableVertexAttribArray(i);
+				}
+
+				glBindVertexArray(0);
+
+				shader = new ParticleShader();
+			}
+
+			GLintptr at;
+			ParticleVertex* vertices = (ParticleVertex*)stream->alloc(len * sizeof(ParticleVertex), sizeof(ParticleVertex), at);
+
+			len = particles.gather(vertices, viewMat, vec2(width, height), zoom, alpha, particleLod);
+			stream->shrink(at, len * sizeof(ParticleVertex));
+
+			glBindVertexArray(vao);
+			glBindVertexBuffer(0, stream->id, at, sizeof(ParticleVertex));
+			glUseProgram(shader->id);
+
+			shader->uView.set(viewMat);
+			shader->uZoom.set(zoom);
+
+			glDrawArrays(GL_POINTS, 0, len);
+
+			glUseProgram(0);
+			glBindVertexArray(0);
 		}
+
+		lighting.render(this, lights);
+
+		stream->advance();
 	}
 
 	void Universe::scroll(GLFWwindow* win, double x, double y) {
@@ -265,6 +500,31 @@ namespace He {
 		case GLFW_KEY_EQUAL:
 		{
 			zoom = 0.05;
+			break;
+		}
+		case GLFW_KEY_LEFT_BRACKET:
+		{
+			if (action == GLFW_PRESS && target.supersample > 0.5) {
+				target.supersample -= 0.25;
+			}
+
+			break;
+		}
+		case GLFW_KEY_RIGHT_BRACKET:
+		{
+			if (action == GLFW_PRESS && target.supersample < 4) {
+				target.supersample += 0.25;
+			}
+
+			break;
+		}
+		case GLFW_KEY_R:
+		{
+			if (action == GLFW_PRESS) {
+				resolution.enabled = !resolution.enabled;
+			}
+
+			break;
 		}
 		};
 
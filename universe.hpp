@@ -2,38 +2,105 @@
 
 #include "main.hpp"
 #include "sfx.hpp"
+#include "physics.hpp"
+#include "gravity.hpp"
+#include "jobs.hpp"
+#include "broadphase.hpp"
+#include "stream.hpp"
+#include "target.hpp"
 #include "argon.hpp"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
-#define aliasW 2
-#define aliasH 2
-
 using namespace Ar;
 using namespace glm;
 
 namespace He {
+	enum class Integrator {
+		Euler,
+		SemiImplicit,
+		Leapfrog,
+		Adaptive
+	};
+
+	struct TickTimings {
+	public:
+		double ships = 0, gravity = 0, integrate = 0, sleep = 0, broadphase = 0, particles = 0;
+	};
+
 	struct Universe : public GLComponent {
 	public:
 		GLFrame* frame;
 		NVGcontext* vg;
-		double last = 0, delta = 0;
-		float aRatio = 1, zoom = 0.05;
+		double last = 0, delta = 1.0 / 60, frameDelta = 0, accumulator = 0;
+		uint32_t maxSteps = 8, maxSubsteps = 16, sleepCursor = 0;
+		float alpha = 0, aRatio = 1, zoom = 0.05, eta = 0.05, length = 1, particleLod = 1;
+		float sleepVelocity = 0.05, sleepAcceleration = 0.01, sleepTime = 1;
+		bool headless = false, sleeping = true, compute = false;
+		Integrator integrator = Integrator::Leapfrog;
+		int32_t originX = 0, originY = 0;
+		vec2 camera = vec2(0);
 		mat4 viewMat = mat4(1);
+		vec2 cursor = vec2(0);
+		bool firing = false;
 		vector<Light> lights;
+		vector<Sprite> sprites;
 		//vector<LineLight> lineLights;
-		vector<PhysicsObject*> objects;
-		LinkedList<Particle> particles = LinkedList<Particle>();
+		vector<Starship*> ships;
+		PhysicsWorld objects;
+		PhysicsObject focus;
+		QuadTree gravity;
+		JobSystem jobs;
+		SpatialHash broadphase;
+		TickTimings timings;
+		Random random = Random(1);
+		vector<Emission> emissions;
+		ParticlePool particles;
+		GpuParticlePool gpuParticles;
+		LightGrid lighting;
+		SpriteBatch spriteBatch;
 
-		Shader* postShader;
+		PostShader* postShader;
 		StarshipShader* shipShader;
-		GLuint fbo, tex, vao, vbo, lightBuf, lineBuf;
+		FleetRenderer* fleet;
+		StreamBuffer* stream;
+		RenderTarget target;
+		ResolutionController resolution;
+		GLuint vao, vbo;
+
+		Universe();
 
 		Universe(GLFrame* frame);
 
+		void useCompute(uint32_t capacity);
+
+		void emit(const Particle& p);
+
+		void spawn();
+
 		void startFrame();
 
+		void tick();
+
+		void step(float dt);
+
+		void accelerate();
+
+		void kick(float dt);
+
+		void drift(float dt);
+
+		void rebase();
+
+		void probe();
+
+		void islands();
+
+		vec2 relative(PhysicsObject obj);
+
+		vec2 interpolated(PhysicsObject obj);
+
 		void postFrame();
 
 		void scroll(GLFWwindow* win, double x, double y);